@@ -0,0 +1,405 @@
+#ifndef BLAKE2F_H_
+#define BLAKE2F_H_
+
+/*
+ * BLAKE2b compression function F, as used by the blake2F precompile
+ * (EIP-152).
+ *
+ * f_generic is kept as the reference implementation. blake2f_compress is the
+ * entry point used by the precompile: it dispatches to a 2x64-bit SIMD
+ * version when the host target has SSSE3 (x86 builds with -mssse3 or
+ * -march=native) and to a fully unrolled scalar version otherwise, which is
+ * what the RISC-V build on ckb-vm runs.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static uint8_t precomputed[10][16] = {
+    {0, 2, 4, 6, 1, 3, 5, 7, 8, 10, 12, 14, 9, 11, 13, 15},
+    {14, 4, 9, 13, 10, 8, 15, 6, 1, 0, 11, 5, 12, 2, 7, 3},
+    {11, 12, 5, 15, 8, 0, 2, 13, 10, 3, 7, 9, 14, 6, 1, 4},
+    {7, 3, 13, 11, 9, 1, 12, 14, 2, 5, 4, 15, 6, 10, 0, 8},
+    {9, 5, 2, 10, 0, 7, 4, 15, 14, 11, 6, 3, 1, 12, 8, 13},
+    {2, 6, 0, 8, 12, 10, 11, 3, 4, 7, 15, 1, 13, 5, 14, 9},
+    {12, 1, 14, 4, 5, 15, 13, 10, 0, 6, 9, 8, 7, 3, 2, 11},
+    {13, 7, 12, 3, 11, 14, 1, 9, 5, 15, 8, 2, 0, 4, 6, 10},
+    {6, 14, 11, 0, 15, 9, 3, 8, 12, 13, 1, 10, 2, 7, 4, 5},
+    {10, 8, 7, 1, 2, 4, 6, 5, 15, 9, 3, 13, 11, 14, 12, 0},
+};
+static uint64_t iv[8] = {
+    0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b,
+    0xa54ff53a5f1d36f1, 0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+    0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+};
+
+uint64_t rotate_left64(uint64_t x, int k) {
+  size_t n = 64;
+  size_t s = (size_t)(k) & (n - 1);
+  return x << s | x >> (n - s);
+}
+
+/* function f_generic is translated from https://github.com/ethereum/go-ethereum/blob/8647233a8ec2a2410a078013ca12c38fdc229866/crypto/blake2b/blake2b_generic.go#L46-L180 */
+void f_generic(uint64_t h[8], uint64_t m[16], uint64_t c0, uint64_t c1,
+               uint64_t flag, uint64_t rounds) {
+  uint64_t v0 = h[0];
+  uint64_t v1 = h[1];
+  uint64_t v2 = h[2];
+  uint64_t v3 = h[3];
+  uint64_t v4 = h[4];
+  uint64_t v5 = h[5];
+  uint64_t v6 = h[6];
+  uint64_t v7 = h[7];
+  uint64_t v8 = iv[0];
+  uint64_t v9 = iv[1];
+  uint64_t v10 = iv[2];
+  uint64_t v11 = iv[3];
+  uint64_t v12 = iv[4];
+  uint64_t v13 = iv[5];
+  uint64_t v14 = iv[6];
+  uint64_t v15 = iv[7];
+  v12 ^= c0;
+  v13 ^= c1;
+  v14 ^= flag;
+
+  for (uint64_t i = 0; i < rounds; i++) {
+    uint8_t* s = precomputed[i % 10];
+
+    v0 += m[s[0]];
+    v0 += v4;
+    v12 ^= v0;
+    v12 = rotate_left64(v12, -32);
+    v8 += v12;
+    v4 ^= v8;
+    v4 = rotate_left64(v4, -24);
+    v1 += m[s[1]];
+    v1 += v5;
+    v13 ^= v1;
+    v13 = rotate_left64(v13, -32);
+    v9 += v13;
+    v5 ^= v9;
+    v5 = rotate_left64(v5, -24);
+    v2 += m[s[2]];
+    v2 += v6;
+    v14 ^= v2;
+    v14 = rotate_left64(v14, -32);
+    v10 += v14;
+    v6 ^= v10;
+    v6 = rotate_left64(v6, -24);
+    v3 += m[s[3]];
+    v3 += v7;
+    v15 ^= v3;
+    v15 = rotate_left64(v15, -32);
+    v11 += v15;
+    v7 ^= v11;
+    v7 = rotate_left64(v7, -24);
+
+    v0 += m[s[4]];
+    v0 += v4;
+    v12 ^= v0;
+    v12 = rotate_left64(v12, -16);
+    v8 += v12;
+    v4 ^= v8;
+    v4 = rotate_left64(v4, -63);
+    v1 += m[s[5]];
+    v1 += v5;
+    v13 ^= v1;
+    v13 = rotate_left64(v13, -16);
+    v9 += v13;
+    v5 ^= v9;
+    v5 = rotate_left64(v5, -63);
+    v2 += m[s[6]];
+    v2 += v6;
+    v14 ^= v2;
+    v14 = rotate_left64(v14, -16);
+    v10 += v14;
+    v6 ^= v10;
+    v6 = rotate_left64(v6, -63);
+    v3 += m[s[7]];
+    v3 += v7;
+    v15 ^= v3;
+    v15 = rotate_left64(v15, -16);
+    v11 += v15;
+    v7 ^= v11;
+    v7 = rotate_left64(v7, -63);
+
+    v0 += m[s[8]];
+    v0 += v5;
+    v15 ^= v0;
+    v15 = rotate_left64(v15, -32);
+    v10 += v15;
+    v5 ^= v10;
+    v5 = rotate_left64(v5, -24);
+    v1 += m[s[9]];
+    v1 += v6;
+    v12 ^= v1;
+    v12 = rotate_left64(v12, -32);
+    v11 += v12;
+    v6 ^= v11;
+    v6 = rotate_left64(v6, -24);
+    v2 += m[s[10]];
+    v2 += v7;
+    v13 ^= v2;
+    v13 = rotate_left64(v13, -32);
+    v8 += v13;
+    v7 ^= v8;
+    v7 = rotate_left64(v7, -24);
+    v3 += m[s[11]];
+    v3 += v4;
+    v14 ^= v3;
+    v14 = rotate_left64(v14, -32);
+    v9 += v14;
+    v4 ^= v9;
+    v4 = rotate_left64(v4, -24);
+
+    v0 += m[s[12]];
+    v0 += v5;
+    v15 ^= v0;
+    v15 = rotate_left64(v15, -16);
+    v10 += v15;
+    v5 ^= v10;
+    v5 = rotate_left64(v5, -63);
+    v1 += m[s[13]];
+    v1 += v6;
+    v12 ^= v1;
+    v12 = rotate_left64(v12, -16);
+    v11 += v12;
+    v6 ^= v11;
+    v6 = rotate_left64(v6, -63);
+    v2 += m[s[14]];
+    v2 += v7;
+    v13 ^= v2;
+    v13 = rotate_left64(v13, -16);
+    v8 += v13;
+    v7 ^= v8;
+    v7 = rotate_left64(v7, -63);
+    v3 += m[s[15]];
+    v3 += v4;
+    v14 ^= v3;
+    v14 = rotate_left64(v14, -16);
+    v9 += v14;
+    v4 ^= v9;
+    v4 = rotate_left64(v4, -63);
+  }
+  h[0] ^= v0 ^ v8;
+  h[1] ^= v1 ^ v9;
+  h[2] ^= v2 ^ v10;
+  h[3] ^= v3 ^ v11;
+  h[4] ^= v4 ^ v12;
+  h[5] ^= v5 ^ v13;
+  h[6] ^= v6 ^ v14;
+  h[7] ^= v7 ^ v15;
+}
+
+/*
+ * Scalar BLAKE2b mixing function G with the message words already selected,
+ * rotation amounts are the BLAKE2b constants 32, 24, 16 and 63.
+ */
+#define BLAKE2F_ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define BLAKE2F_G(a, b, c, d, x, y) \
+  do {                              \
+    a += b + (x);                   \
+    d = BLAKE2F_ROTR64(d ^ a, 32);  \
+    c += d;                         \
+    b = BLAKE2F_ROTR64(b ^ c, 24);  \
+    a += b + (y);                   \
+    d = BLAKE2F_ROTR64(d ^ a, 16);  \
+    c += d;                         \
+    b = BLAKE2F_ROTR64(b ^ c, 63);  \
+  } while (0)
+
+/*
+ * One round with its message schedule given as literals, so the sigma
+ * permutation is resolved at compile time instead of through
+ * precomputed[i % 10]. The argument order follows the rows of precomputed.
+ */
+#define BLAKE2F_ROUND(s0, s1, s2, s3, s4, s5, s6, s7, s8, s9, s10, s11, s12, \
+                      s13, s14, s15)                                       \
+  do {                                                                     \
+    BLAKE2F_G(v0, v4, v8, v12, m[s0], m[s4]);                              \
+    BLAKE2F_G(v1, v5, v9, v13, m[s1], m[s5]);                              \
+    BLAKE2F_G(v2, v6, v10, v14, m[s2], m[s6]);                             \
+    BLAKE2F_G(v3, v7, v11, v15, m[s3], m[s7]);                             \
+    BLAKE2F_G(v0, v5, v10, v15, m[s8], m[s12]);                            \
+    BLAKE2F_G(v1, v6, v11, v12, m[s9], m[s13]);                            \
+    BLAKE2F_G(v2, v7, v8, v13, m[s10], m[s14]);                            \
+    BLAKE2F_G(v3, v4, v9, v14, m[s11], m[s15]);                            \
+  } while (0)
+
+/*
+ * Apply the 10 sigma rounds in order, stopping as soon as `left` reaches
+ * zero. EIP-152 allows any round count up to 2^32 - 1, so a partial block of
+ * rounds has to be supported without falling back to a table lookup.
+ */
+#define BLAKE2F_ROUNDS(ROUND, left)                                    \
+  while (left > 0) {                                                   \
+    ROUND(0, 2, 4, 6, 1, 3, 5, 7, 8, 10, 12, 14, 9, 11, 13, 15);       \
+    if (--left == 0) break;                                            \
+    ROUND(14, 4, 9, 13, 10, 8, 15, 6, 1, 0, 11, 5, 12, 2, 7, 3);       \
+    if (--left == 0) break;                                            \
+    ROUND(11, 12, 5, 15, 8, 0, 2, 13, 10, 3, 7, 9, 14, 6, 1, 4);       \
+    if (--left == 0) break;                                            \
+    ROUND(7, 3, 13, 11, 9, 1, 12, 14, 2, 5, 4, 15, 6, 10, 0, 8);       \
+    if (--left == 0) break;                                            \
+    ROUND(9, 5, 2, 10, 0, 7, 4, 15, 14, 11, 6, 3, 1, 12, 8, 13);       \
+    if (--left == 0) break;                                            \
+    ROUND(2, 6, 0, 8, 12, 10, 11, 3, 4, 7, 15, 1, 13, 5, 14, 9);       \
+    if (--left == 0) break;                                            \
+    ROUND(12, 1, 14, 4, 5, 15, 13, 10, 0, 6, 9, 8, 7, 3, 2, 11);       \
+    if (--left == 0) break;                                            \
+    ROUND(13, 7, 12, 3, 11, 14, 1, 9, 5, 15, 8, 2, 0, 4, 6, 10);       \
+    if (--left == 0) break;                                            \
+    ROUND(6, 14, 11, 0, 15, 9, 3, 8, 12, 13, 1, 10, 2, 7, 4, 5);       \
+    if (--left == 0) break;                                            \
+    ROUND(10, 8, 7, 1, 2, 4, 6, 5, 15, 9, 3, 13, 11, 14, 12, 0);       \
+    --left;                                                            \
+  }
+
+/* Fully unrolled scalar F, the working state stays in 16 local registers */
+void f_unrolled(uint64_t h[8], const uint64_t m[16], uint64_t c0, uint64_t c1,
+                uint64_t flag, uint64_t rounds) {
+  uint64_t v0 = h[0], v1 = h[1], v2 = h[2], v3 = h[3];
+  uint64_t v4 = h[4], v5 = h[5], v6 = h[6], v7 = h[7];
+  uint64_t v8 = iv[0], v9 = iv[1], v10 = iv[2], v11 = iv[3];
+  uint64_t v12 = iv[4] ^ c0, v13 = iv[5] ^ c1, v14 = iv[6] ^ flag,
+           v15 = iv[7];
+
+  uint64_t left = rounds;
+  BLAKE2F_ROUNDS(BLAKE2F_ROUND, left);
+
+  h[0] ^= v0 ^ v8;
+  h[1] ^= v1 ^ v9;
+  h[2] ^= v2 ^ v10;
+  h[3] ^= v3 ^ v11;
+  h[4] ^= v4 ^ v12;
+  h[5] ^= v5 ^ v13;
+  h[6] ^= v6 ^ v14;
+  h[7] ^= v7 ^ v15;
+}
+
+#if defined(__SSE2__)
+/*
+ * SIMD F: the 4x4 state is kept as 8 registers of two 64-bit lanes each,
+ * the four column (and then diagonal) G functions run two per instruction.
+ * It builds with baseline SSE2 so bench_blake2f can always compare it, but
+ * with only SSE2 shifts for the 24/16-bit rotations it measures slower than
+ * f_unrolled, so blake2f_compress picks it only when SSSE3 byte shuffles are
+ * available.
+ */
+#if defined(__SSSE3__)
+#define BLAKE2F_SIMD_ROTR64(x, n)                                           \
+  ((n) == 32   ? _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))             \
+   : (n) == 24 ? _mm_shuffle_epi8(x, _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, \
+                                                   11, 12, 13, 14, 15, 8, \
+                                                   9, 10))                \
+   : (n) == 16 ? _mm_shuffle_epi8(x, _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, \
+                                                   10, 11, 12, 13, 14, 15, \
+                                                   8, 9))                 \
+               : _mm_xor_si128(_mm_srli_epi64(x, 63), _mm_add_epi64(x, x)))
+#else
+#define BLAKE2F_SIMD_ROTR64(x, n)                                        \
+  ((n) == 32 ? _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))             \
+   : (n) == 63                                                           \
+       ? _mm_xor_si128(_mm_srli_epi64(x, 63), _mm_add_epi64(x, x))       \
+       : _mm_xor_si128(_mm_srli_epi64(x, n), _mm_slli_epi64(x, 64 - (n))))
+#endif
+#define BLAKE2F_SIMD_LOAD(x, y) _mm_set_epi64x((long long)m[y], (long long)m[x])
+
+#define BLAKE2F_SIMD_HALF_G(b0, b1, r1, r2)                         \
+  do {                                                              \
+    row1l = _mm_add_epi64(_mm_add_epi64(row1l, b0), row2l);         \
+    row1h = _mm_add_epi64(_mm_add_epi64(row1h, b1), row2h);         \
+    row4l = BLAKE2F_SIMD_ROTR64(_mm_xor_si128(row4l, row1l), r1);   \
+    row4h = BLAKE2F_SIMD_ROTR64(_mm_xor_si128(row4h, row1h), r1);   \
+    row3l = _mm_add_epi64(row3l, row4l);                            \
+    row3h = _mm_add_epi64(row3h, row4h);                            \
+    row2l = BLAKE2F_SIMD_ROTR64(_mm_xor_si128(row2l, row3l), r2);   \
+    row2h = BLAKE2F_SIMD_ROTR64(_mm_xor_si128(row2h, row3h), r2);   \
+  } while (0)
+
+/* rotate rows 2, 3 and 4 left by 1, 2 and 3 words */
+#define BLAKE2F_SIMD_DIAGONALIZE()                                          \
+  do {                                                                      \
+    __m128i t0 = row4l, t1 = row2l;                                         \
+    row4l = row3l;                                                          \
+    row3l = row3h;                                                          \
+    row3h = row4l;                                                          \
+    row4l = _mm_unpackhi_epi64(row4h, _mm_unpacklo_epi64(t0, t0));          \
+    row4h = _mm_unpackhi_epi64(t0, _mm_unpacklo_epi64(row4h, row4h));       \
+    row2l = _mm_unpackhi_epi64(row2l, _mm_unpacklo_epi64(row2h, row2h));    \
+    row2h = _mm_unpackhi_epi64(row2h, _mm_unpacklo_epi64(t1, t1));          \
+  } while (0)
+
+#define BLAKE2F_SIMD_UNDIAGONALIZE()                                        \
+  do {                                                                      \
+    __m128i t0 = row3l, t1;                                                 \
+    row3l = row3h;                                                          \
+    row3h = t0;                                                             \
+    t0 = row2l;                                                             \
+    t1 = row4l;                                                             \
+    row2l = _mm_unpackhi_epi64(row2h, _mm_unpacklo_epi64(row2l, row2l));    \
+    row2h = _mm_unpackhi_epi64(t0, _mm_unpacklo_epi64(row2h, row2h));       \
+    row4l = _mm_unpackhi_epi64(row4l, _mm_unpacklo_epi64(row4h, row4h));    \
+    row4h = _mm_unpackhi_epi64(row4h, _mm_unpacklo_epi64(t1, t1));          \
+  } while (0)
+
+#define BLAKE2F_SIMD_ROUND(s0, s1, s2, s3, s4, s5, s6, s7, s8, s9, s10,    \
+                           s11, s12, s13, s14, s15)                        \
+  do {                                                                     \
+    BLAKE2F_SIMD_HALF_G(BLAKE2F_SIMD_LOAD(s0, s1),                         \
+                        BLAKE2F_SIMD_LOAD(s2, s3), 32, 24);                \
+    BLAKE2F_SIMD_HALF_G(BLAKE2F_SIMD_LOAD(s4, s5),                         \
+                        BLAKE2F_SIMD_LOAD(s6, s7), 16, 63);                \
+    BLAKE2F_SIMD_DIAGONALIZE();                                            \
+    BLAKE2F_SIMD_HALF_G(BLAKE2F_SIMD_LOAD(s8, s9),                         \
+                        BLAKE2F_SIMD_LOAD(s10, s11), 32, 24);              \
+    BLAKE2F_SIMD_HALF_G(BLAKE2F_SIMD_LOAD(s12, s13),                       \
+                        BLAKE2F_SIMD_LOAD(s14, s15), 16, 63);              \
+    BLAKE2F_SIMD_UNDIAGONALIZE();                                          \
+  } while (0)
+
+void f_simd128(uint64_t h[8], const uint64_t m[16], uint64_t c0, uint64_t c1,
+            uint64_t flag, uint64_t rounds) {
+  const __m128i h01 = _mm_loadu_si128((const __m128i*)&h[0]);
+  const __m128i h23 = _mm_loadu_si128((const __m128i*)&h[2]);
+  const __m128i h45 = _mm_loadu_si128((const __m128i*)&h[4]);
+  const __m128i h67 = _mm_loadu_si128((const __m128i*)&h[6]);
+  __m128i row1l = h01, row1h = h23;
+  __m128i row2l = h45, row2h = h67;
+  __m128i row3l = _mm_loadu_si128((const __m128i*)&iv[0]);
+  __m128i row3h = _mm_loadu_si128((const __m128i*)&iv[2]);
+  __m128i row4l = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&iv[4]),
+                                _mm_set_epi64x((long long)c1, (long long)c0));
+  __m128i row4h = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&iv[6]),
+                                _mm_set_epi64x(0, (long long)flag));
+
+  uint64_t left = rounds;
+  BLAKE2F_ROUNDS(BLAKE2F_SIMD_ROUND, left);
+
+  _mm_storeu_si128((__m128i*)&h[0],
+                   _mm_xor_si128(h01, _mm_xor_si128(row1l, row3l)));
+  _mm_storeu_si128((__m128i*)&h[2],
+                   _mm_xor_si128(h23, _mm_xor_si128(row1h, row3h)));
+  _mm_storeu_si128((__m128i*)&h[4],
+                   _mm_xor_si128(h45, _mm_xor_si128(row2l, row4l)));
+  _mm_storeu_si128((__m128i*)&h[6],
+                   _mm_xor_si128(h67, _mm_xor_si128(row2h, row4h)));
+}
+#endif /* __SSE2__ */
+
+void blake2f_compress(uint64_t h[8], const uint64_t m[16], uint64_t c0,
+                      uint64_t c1, uint64_t flag, uint64_t rounds) {
+#if defined(__SSSE3__)
+  f_simd128(h, m, c0, c1, flag, rounds);
+#else
+  f_unrolled(h, m, c0, c1, flag, rounds);
+#endif
+}
+
+#endif /* BLAKE2F_H_ */
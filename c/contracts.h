@@ -2,12 +2,14 @@
 #define CONTRACTS_H_
 
 #include "mbedtls/bignum.h"
+#include "blake2f.h"
 #include "ripemd160.h"
-#include "sha256.h"
+#include "sha256_blocks.h"
 
 #include "polyjuice_utils.h"
 #include "sudt_contracts.h"
 #include "other_contracts.h"
+#include "modexp.h"
 
 /* Protocol Params:
    [Referenced]:
@@ -29,6 +31,8 @@
 #define BN256_PAIRING_PERPOINT_GAS_BYZANTIUM 80000  // Byzantium per-point price for an elliptic curve pairing check
 #define BN256_PAIRING_PERPOINT_GAS_ISTANBUL  34000  // Per-point price for an elliptic curve pairing check
 
+#define BATCH_ECRECOVER_PER_SIGNATURE_GAS 3000 // Same as a single ecrecover
+
 #define BLAKE2F_INPUT_LENGTH 213
 #define BLAKE2F_FINAL_BLOCK_BYTES 0x1
 #define BLAKE2F_NON_FINAL_BLOCK_BYTES 0x0
@@ -37,7 +41,8 @@
 
 typedef int (*precompiled_contract_gas_fn)(const uint8_t* input_src,
                                            const size_t input_size,
-                                           uint64_t* gas);
+                                           uint64_t* gas,
+                                           precompiled_input_t* parsed);
 typedef int (*precompiled_contract_fn)(gw_context_t* ctx,
                                        const uint8_t* code_data,
                                        const size_t code_size,
@@ -45,51 +50,57 @@ typedef int (*precompiled_contract_fn)(gw_context_t* ctx,
                                        bool is_static_call,
                                        const uint8_t* input_src,
                                        const size_t input_size,
-                                       uint8_t** output, size_t* output_size);
+                                       precompiled_output_t* output,
+                                       const precompiled_input_t* parsed);
 
 int ecrecover_required_gas(const uint8_t* input, const size_t input_size,
-                           uint64_t* gas) {
+                           uint64_t* gas,
+                           precompiled_input_t* parsed) {
   // Elliptic curve sender recovery gas price
   *gas = 3000;
   return 0;
 }
 
 /*
- * ecrecover() is a useful Solidity function.
- * It allows the smart contract to validate that incoming data is properly signed.
- * When input data is wrong we just return empty output with 0 return code.
-
-  The input data: (hash, v, r, s), each 32 bytes
-  ===============
-    input[0 ..32]  => hash
-    input[32..64]  => v (padded)
-         [64]      => v
-    input[64..128] => signature[0..64]
-         [64..96 ] => r
-         [96..128] => s
+ * The secp256k1 context and its precomputed tables (CKB_SECP256K1_DATA_SIZE
+ * bytes), loaded on first use and shared by all signature pre-compiled
+ * contracts for the rest of the process.
  */
-int ecrecover(gw_context_t* ctx,
-              const uint8_t* code_data,
-              const size_t code_size,
-              const enum evmc_call_kind parent_kind,
-              bool is_static_call,
-              const uint8_t* input_src,
-              const size_t input_size, uint8_t** output, size_t* output_size) {
-  int ret;
-  secp256k1_context context;
-  uint8_t secp_data[CKB_SECP256K1_DATA_SIZE];
+static secp256k1_context g_secp256k1_context;
+static uint8_t* g_secp256k1_data = NULL;
+
+int load_secp256k1_context(gw_context_t* ctx, secp256k1_context** context) {
+  if (g_secp256k1_data == NULL) {
+    uint8_t* data = (uint8_t*)malloc(CKB_SECP256K1_DATA_SIZE);
+    if (data == NULL) {
+      return FATAL_PRECOMPILED_CONTRACTS;
+    }
 #ifdef GW_GENERATOR
-  ret = ckb_secp256k1_custom_verify_only_initialize(ctx, &context, secp_data);
+    int ret = ckb_secp256k1_custom_verify_only_initialize(
+        ctx, &g_secp256k1_context, data);
 #else
-  ret = ckb_secp256k1_custom_verify_only_initialize(&context, secp_data);
+    int ret = ckb_secp256k1_custom_verify_only_initialize(
+        &g_secp256k1_context, data);
 #endif
-  if (ret != 0) {
-    return FATAL_PRECOMPILED_CONTRACTS;
+    if (ret != 0) {
+      free(data);
+      return FATAL_PRECOMPILED_CONTRACTS;
+    }
+    g_secp256k1_data = data;
   }
+  *context = &g_secp256k1_context;
+  return 0;
+}
 
-  uint8_t input[128] = {0};
-  size_t real_size = input_size > 128 ? 128 : input_size;
-  memcpy(input, input_src, real_size);
+/*
+ * Recover the signer of one (hash, v, r, s) tuple, see `ecrecover`
+ *
+ * @param address the recovered address, left padded to 32 bytes
+ * @param recovered false if the signature is invalid, `address` is untouched
+ */
+int recover_eth_address(secp256k1_context* context, const uint8_t input[128],
+                        uint8_t address[32], bool* recovered) {
+  *recovered = false;
   for (int i = 32; i < 63; i++) {
     if (input[i] != 0) {
       ckb_debug("input[32:63] not all zero!");
@@ -110,13 +121,13 @@ int ecrecover(gw_context_t* ctx,
   memcpy(signature_data + 32, input + 96, 32);
   secp256k1_ecdsa_recoverable_signature signature;
   if (secp256k1_ecdsa_recoverable_signature_parse_compact(
-          &context, &signature, signature_data, recid) == 0) {
+          context, &signature, signature_data, recid) == 0) {
     ckb_debug("parse signature failed");
     return 0;
   }
   /* Recover pubkey */
   secp256k1_pubkey pubkey;
-  if (secp256k1_ecdsa_recover(&context, &pubkey, &signature, input) != 1) {
+  if (secp256k1_ecdsa_recover(context, &pubkey, &signature, input) != 1) {
     ckb_debug("recover public key failed");
     return 0;
   }
@@ -124,25 +135,129 @@ int ecrecover(gw_context_t* ctx,
   /* Check pubkey hash */
   uint8_t temp[65];
   size_t pubkey_size = 65;
-  if (secp256k1_ec_pubkey_serialize(&context, temp, &pubkey_size, &pubkey,
+  if (secp256k1_ec_pubkey_serialize(context, temp, &pubkey_size, &pubkey,
                                     SECP256K1_EC_UNCOMPRESSED) != 1) {
     ckb_debug("public key serialize failed");
     return FATAL_PRECOMPILED_CONTRACTS;
   }
 
   union ethash_hash256 hash_result = ethash::keccak256(temp + 1, 64);
-  *output = (uint8_t*)malloc(32);
-  if (*output == NULL) {
+  memset(address, 0, 12);
+  memcpy(address + 12, hash_result.bytes + 12, 20);
+  *recovered = true;
+  return 0;
+}
+
+/*
+ * ecrecover() is a useful Solidity function.
+ * It allows the smart contract to validate that incoming data is properly signed.
+ * When input data is wrong we just return empty output with 0 return code.
+
+  The input data: (hash, v, r, s), each 32 bytes
+  ===============
+    input[0 ..32]  => hash
+    input[32..64]  => v (padded)
+         [64]      => v
+    input[64..128] => signature[0..64]
+         [64..96 ] => r
+         [96..128] => s
+ */
+int ecrecover(gw_context_t* ctx,
+              const uint8_t* code_data,
+              const size_t code_size,
+              const enum evmc_call_kind parent_kind,
+              bool is_static_call,
+              const uint8_t* input_src,
+              const size_t input_size, precompiled_output_t* output,
+              const precompiled_input_t* parsed) {
+  secp256k1_context* context = NULL;
+  int ret = load_secp256k1_context(ctx, &context);
+  if (ret != 0) {
+    return ret;
+  }
+
+  uint8_t input[128] = {0};
+  size_t real_size = input_size > 128 ? 128 : input_size;
+  memcpy(input, input_src, real_size);
+  uint8_t address[32];
+  bool recovered = false;
+  ret = recover_eth_address(context, input, address, &recovered);
+  if (ret != 0 || !recovered) {
+    return ret;
+  }
+
+  uint8_t* out = alloc_precompiled_output(output, 32);
+  if (out == NULL) {
+    return FATAL_PRECOMPILED_CONTRACTS;
+  }
+  memcpy(out, address, 32);
+  output->size = 32;
+  return 0;
+}
+
+int batch_ecrecover_gas(const uint8_t* input_src, const size_t input_size,
+                        uint64_t* gas,
+                        precompiled_input_t* parsed) {
+  *gas = (uint64_t)((input_size + 127) / 128) * BATCH_ECRECOVER_PER_SIGNATURE_GAS;
+  return 0;
+}
+
+/*
+ * Recover the signers of a list of signatures in one call.
+
+  input: n tuples of (hash, v, r, s), the same 128 bytes as ecrecover input
+  ======
+    input[128*i      .. 128*i+32 ] => hash
+    input[128*i+32   .. 128*i+64 ] => v (padded)
+    input[128*i+64   .. 128*i+96 ] => r
+    input[128*i+96   .. 128*i+128] => s
+
+  output (32 * n bytes):
+  =======
+    output[32*i .. 32*i+32] => signer address of tuple i (left padded),
+                               all zero if the signature is invalid
+ */
+int batch_ecrecover(gw_context_t* ctx,
+                    const uint8_t* code_data,
+                    const size_t code_size,
+                    const enum evmc_call_kind parent_kind,
+                    bool is_static_call,
+                    const uint8_t* input_src,
+                    const size_t input_size,
+                    precompiled_output_t* output,
+                    const precompiled_input_t* parsed) {
+  if (input_size == 0 || input_size % 128 != 0) {
+    debug_print_int("[batch_ecrecover] invalid input size", input_size);
+    return ERROR_BATCH_ECRECOVER;
+  }
+  secp256k1_context* context = NULL;
+  int ret = load_secp256k1_context(ctx, &context);
+  if (ret != 0) {
+    return ret;
+  }
+
+  size_t count = input_size / 128;
+  uint8_t* out = alloc_precompiled_output(output, count * 32);
+  if (out == NULL) {
     return FATAL_PRECOMPILED_CONTRACTS;
   }
-  memset(*output, 0, 12);
-  memcpy(*output + 12, hash_result.bytes + 12, 20);
-  *output_size = 32;
+  memset(out, 0, count * 32);
+  for (size_t i = 0; i < count; i++) {
+    bool recovered = false;
+    ret = recover_eth_address(context, input_src + i * 128, out + i * 32,
+                              &recovered);
+    if (ret != 0) {
+      free_precompiled_output(output);
+      return ret;
+    }
+  }
+  output->size = count * 32;
   return 0;
 }
 
 int sha256hash_required_gas(const uint8_t* input, const size_t input_size,
-                            uint64_t* gas) {
+                            uint64_t* gas,
+                            precompiled_input_t* parsed) {
   *gas =
       (uint64_t)(input_size + 31) / 32 * SHA256_PERWORD_GAS + SHA256_BASE_GAS;
   return 0;
@@ -154,21 +269,20 @@ int sha256hash(gw_context_t* ctx,
                const enum evmc_call_kind parent_kind,
                bool is_static_call,
                const uint8_t* input_src,
-               const size_t input_size, uint8_t** output, size_t* output_size) {
-  *output = (uint8_t*)malloc(32);
-  if (*output == NULL) {
+               const size_t input_size, precompiled_output_t* output,
+               const precompiled_input_t* parsed) {
+  uint8_t* out = alloc_precompiled_output(output, 32);
+  if (out == NULL) {
     return FATAL_PRECOMPILED_CONTRACTS;
   }
-  *output_size = 32;
-  SHA256_CTX hash_ctx;
-  sha256_init(&hash_ctx);
-  sha256_update(&hash_ctx, input_src, input_size);
-  sha256_final(&hash_ctx, *output);
+  output->size = 32;
+  sha256_digest(input_src, input_size, out);
   return 0;
 }
 
 int ripemd160hash_required_gas(const uint8_t* input, const size_t input_size,
-                               uint64_t* gas) {
+                               uint64_t* gas,
+                               precompiled_input_t* parsed) {
   *gas = (uint64_t)(input_size + 31) / 32 * RIPEMD160_PERWORD_GAS +
          RIPEMD160_BASE_GAS;
   return 0;
@@ -180,259 +294,201 @@ int ripemd160hash(gw_context_t* ctx,
                   const enum evmc_call_kind parent_kind,
                   bool is_static_call,
                   const uint8_t* input_src,
-                  const size_t input_size, uint8_t** output,
-                  size_t* output_size) {
+                  const size_t input_size, precompiled_output_t* output,
+                  const precompiled_input_t* parsed) {
   if (input_size > (size_t)UINT32_MAX) {
     /* input_size overflow */
     return FATAL_PRECOMPILED_CONTRACTS;
   }
-  *output = (uint8_t*)malloc(32);
-  if (*output == NULL) {
+  uint8_t* out = alloc_precompiled_output(output, 32);
+  if (out == NULL) {
     return -1;
   }
-  memset(*output, 0, 12);
-  ripemd160(input_src, input_size, *output + 12);
-  *output_size = 32;
+  memset(out, 0, 12);
+  ripemd160(input_src, input_size, out + 12);
+  output->size = 32;
   return 0;
 }
 
 int data_copy_required_gas(const uint8_t* input, const size_t input_size,
-                           uint64_t* gas) {
+                           uint64_t* gas,
+                           precompiled_input_t* parsed) {
   *gas = (uint64_t)(input_size + 31) / 32 * IDENTITY_PERWORD_GAS +
          IDENTITY_BASE_GAS;
   return 0;
 }
 
+/* The copy goes straight into the caller's output arena when it fits. The
+ * input is not borrowed, see precompiled_output_t. */
 int data_copy(gw_context_t* ctx,
               const uint8_t* code_data,
               const size_t code_size,
               const enum evmc_call_kind parent_kind,
               bool is_static_call,
               const uint8_t* input_src,
-              const size_t input_size, uint8_t** output, size_t* output_size) {
-  *output = (uint8_t*)malloc(input_size);
-  if (*output == NULL) {
+              const size_t input_size, precompiled_output_t* output,
+              const precompiled_input_t* parsed) {
+  uint8_t* out = alloc_precompiled_output(output, input_size);
+  if (out == NULL) {
     return FATAL_PRECOMPILED_CONTRACTS;
   }
-  *output_size = input_size;
-  memcpy(*output, input_src, input_size);
+  output->size = input_size;
+  memcpy(out, input_src, input_size);
   return 0;
 }
 
-int read_lens(const uint8_t* input, const size_t input_size,
-              mbedtls_mpi* base_len, mbedtls_mpi* exp_len, mbedtls_mpi* mod_len,
-              size_t* base_size, size_t* exp_size, size_t* mod_size) {
-  int ret;
-
-  uint8_t padded_input[96] = {0};
-  size_t real_size = input_size > 96 ? 96 : input_size;
-  memcpy(padded_input, input, real_size);
-
-  mbedtls_mpi_init(base_len);
-  mbedtls_mpi_init(exp_len);
-  mbedtls_mpi_init(mod_len);
-  ret = mbedtls_mpi_read_binary(base_len, padded_input, 32);
-  if (ret != 0) {
-    goto read_lens_error;
-  }
-  ret = mbedtls_mpi_read_binary(exp_len, padded_input + 32, 32);
-  if (ret != 0) {
-    goto read_lens_error;
-  }
-  ret = mbedtls_mpi_read_binary(mod_len, padded_input + 64, 32);
-  if (ret != 0) {
-    goto read_lens_error;
-  }
+/* view of the `size` bytes at `offset` of the bigModExp payload */
+void mod_exp_operand_view(const uint8_t* payload, const size_t payload_size,
+                          size_t offset, size_t size, const uint8_t** view,
+                          size_t* avail) {
+  if (offset >= payload_size) {
+    *view = NULL;
+    *avail = 0;
+    return;
+  }
+  *view = payload + offset;
+  *avail = payload_size - offset < size ? payload_size - offset : size;
+}
 
-  ret = mbedtls_mpi_write_binary_le(base_len, (unsigned char*)(base_size),
-                                    sizeof(size_t));
-  if (ret != 0) {
-    goto read_lens_error;
-  }
-  ret = mbedtls_mpi_write_binary_le(exp_len, (unsigned char*)(exp_size),
-                                    sizeof(size_t));
-  if (ret != 0) {
-    goto read_lens_error;
-  }
-  ret = mbedtls_mpi_write_binary_le(mod_len, (unsigned char*)(mod_size),
-                                    sizeof(size_t));
-  if (ret != 0) {
-    goto read_lens_error;
+/*
+ * Parse the bigModExp header <base_len><exp_len><mod_len> (32-byte big-endian
+ * each, zero-padded when the input is shorter) and set up views of the three
+ * operands in place, the payload is not copied.
+ */
+int parse_mod_exp_input(const uint8_t* input, const size_t input_size,
+                        precompiled_input_t* parsed) {
+  uint8_t header[96] = {0};
+  size_t header_size = input_size > 96 ? 96 : input_size;
+  if (header_size > 0) {
+    memcpy(header, input, header_size);
+  }
+
+  uint64_t base_size;
+  uint64_t exp_size;
+  uint64_t mod_size;
+  if (parse_u64(header, &base_size) != 0 ||
+      parse_u64(header + 32, &exp_size) != 0 ||
+      parse_u64(header + 64, &mod_size) != 0) {
+    return ERROR_MOD_EXP;
   }
 
-  /* NOTE: if success, don't free base_len/exp_len/mod_len */
+  const uint8_t* payload = input + header_size;
+  const size_t payload_size = input_size - header_size;
+  const size_t mod_offset =
+      base_size > SIZE_MAX - exp_size ? SIZE_MAX : base_size + exp_size;
+  parsed->mod_exp.base_size = base_size;
+  parsed->mod_exp.exp_size = exp_size;
+  parsed->mod_exp.mod_size = mod_size;
+  mod_exp_operand_view(payload, payload_size, 0, base_size,
+                       &parsed->mod_exp.base, &parsed->mod_exp.base_avail);
+  mod_exp_operand_view(payload, payload_size, base_size, exp_size,
+                       &parsed->mod_exp.exp, &parsed->mod_exp.exp_avail);
+  mod_exp_operand_view(payload, payload_size, mod_offset, mod_size,
+                       &parsed->mod_exp.mod, &parsed->mod_exp.mod_avail);
+  parsed->ready = true;
   return 0;
-
- read_lens_error:
-  mbedtls_mpi_free(base_len);
-  mbedtls_mpi_free(exp_len);
-  mbedtls_mpi_free(mod_len);
-  return ERROR_MOD_EXP;
 }
 
-// modexpMultComplexity implements bigModexp multComplexity formula, as defined
-// in EIP-198
+// modexp_mult_complexity implements the multiplication complexity of
+// EIP-2565
 //
 // def mult_complexity(x):
-//    if x <= 64: return x ** 2
-//    elif x <= 1024: return x ** 2 // 4 + 96 * x - 3072
-//    else: return x ** 2 // 16 + 480 * x - 199680
+//    words = math.ceil(x / 8)
+//    return words ** 2
 //
-// where is x is max(length_of_MODULUS, length_of_BASE)
-uint128_t modexp_mult_complexity(uint128_t x) {
-  if (x <= 64) {
-    return x * x;
-  } else if (x <= 1024) {
-    return x * x / 4 + 96 * x - 3072;
-  } else {
-    return x * x / 16 + 480 * x - 199680;
-  }
+// where is x is max(length_of_MODULUS, length_of_BASE). x comes from a u64
+// length so words ** 2 always fits in 128 bits.
+uint128_t modexp_mult_complexity(uint64_t x) {
+  uint128_t words = ((uint128_t)x + 7) / 8;
+  return words * words;
 }
 
-/* EIP-2565: Big integer modular exponentiation: false */
-int big_mod_exp_required_gas(const uint8_t* input, const size_t input_size,
-                             uint64_t* target_gas) {
-  int ret;
-  mbedtls_mpi base_len;
-  mbedtls_mpi exp_len;
-  mbedtls_mpi mod_len;
-  size_t base_size;
-  size_t exp_size;
-  size_t mod_size;
-  ret = read_lens(input, input_size, &base_len, &exp_len, &mod_len, &base_size,
-                  &exp_size, &mod_size);
-  if (ret != 0) {
-    /* if read_lens() failed, base_len/exp_len/mod_len already freed */
-    return ERROR_MOD_EXP;
-  }
-
-  // Retrieve the head 32 bytes of exp for the adjusted exponent length
-  int return_value = 0;
-  mbedtls_mpi exp_head;
-  mbedtls_mpi adj_exp_len;
-  mbedtls_mpi gas_big;
-  mbedtls_mpi_init(&exp_head);
-  mbedtls_mpi_init(&adj_exp_len);
-  mbedtls_mpi_init(&gas_big);
-
-  size_t exp_head_size = exp_size > 32 ? 32 : exp_size;
-  int msb = 0;
-  int exp_head_bitlen = 0;
-  size_t base_gas = 0;
-  uint128_t gas = 0;
-
-  const size_t content_size = base_size + exp_size + mod_size;
-  const size_t copy_size = input_size > content_size + 96
-    ? content_size
-    : (input_size > 96 ? input_size - 96 : 0);
-  uint8_t *content = (uint8_t*)malloc(content_size);
-  if (content == NULL) {
-    return_value = FATAL_PRECOMPILED_CONTRACTS;
-    goto mod_exp_gas_cleanup;
-  }
-  memset(content, 0, content_size);
-  memcpy(content, input + 96, copy_size);
-
-  ret = mbedtls_mpi_read_binary(&exp_head, content + base_size, exp_head_size);
-  if (ret != 0) {
-    return_value = ERROR_MOD_EXP;
-    goto mod_exp_gas_cleanup;
-  }
-  // Calculate the adjusted exponent length
-  exp_head_bitlen = mbedtls_mpi_bitlen(&exp_head);
-  if (exp_head_bitlen > 0) {
-    msb = exp_head_bitlen - 1;
-  }
-  if (exp_size > 32) {
-    ret = mbedtls_mpi_sub_int(&adj_exp_len, &exp_len, 32);
-    if (ret != 0) {
-      return_value = ERROR_MOD_EXP;
-      goto mod_exp_gas_cleanup;
-    }
-    ret = mbedtls_mpi_mul_int(&adj_exp_len, &adj_exp_len, 8);
-    if (ret != 0) {
-      return_value = ERROR_MOD_EXP;
-      goto mod_exp_gas_cleanup;
+/*
+ * EIP-2565 iteration count, the adjusted exponent length:
+ *   exp_size <= 32: bitlen(exp) - 1 (0 for a zero exponent)
+ *   exp_size > 32:  8 * (exp_size - 32) + bitlen(exp_head) - 1
+ * only the leading (at most 32) exponent bytes are looked at.
+ */
+uint128_t modexp_iteration_count(const precompiled_input_t* parsed) {
+  const size_t exp_size = parsed->mod_exp.exp_size;
+  const size_t exp_head_size = exp_size > 32 ? 32 : exp_size;
+  const size_t exp_head_avail = parsed->mod_exp.exp_avail > exp_head_size
+                                    ? exp_head_size
+                                    : parsed->mod_exp.exp_avail;
+  uint64_t msb = 0;
+  for (size_t i = 0; i < exp_head_avail; i++) {
+    uint8_t byte = parsed->mod_exp.exp[i];
+    if (byte != 0) {
+      msb = (exp_head_size - i) * 8 - 1 - (__builtin_clz((uint32_t)byte) - 24);
+      break;
     }
   }
-  ret = mbedtls_mpi_add_int(&adj_exp_len, &adj_exp_len, msb);
-  if (ret != 0) {
-    return_value = ERROR_MOD_EXP;
-    goto mod_exp_gas_cleanup;
-  }
-  // Calculate the gas cost of the operation
-  base_gas = mod_size > base_size ? mod_size : base_size;
-  gas = modexp_mult_complexity((uint128_t)base_gas);
-  ret = mbedtls_mpi_read_binary_le(&gas_big, (unsigned char*)(&gas), 16);
-  if (ret != 0) {
-    return_value = ERROR_MOD_EXP;
-    goto mod_exp_gas_cleanup;
+  uint128_t count = msb;
+  if (exp_size > 32) {
+    count += (uint128_t)(exp_size - 32) * 8;
   }
-  if (mbedtls_mpi_cmp_int(&adj_exp_len, 1) > 0) {
-    ret = mbedtls_mpi_mul_mpi(&gas_big, &gas_big, &adj_exp_len);
-    if (ret != 0) {
-      return_value = ERROR_MOD_EXP;
-      goto mod_exp_gas_cleanup;
-    }
+  return count;
+}
+
+/* EIP-2565: Big integer modular exponentiation: true */
+int big_mod_exp_required_gas(const uint8_t* input, const size_t input_size,
+                             uint64_t* target_gas,
+                             precompiled_input_t* parsed) {
+  precompiled_input_t local_parsed;
+  if (parsed == NULL) {
+    parsed = &local_parsed;
   }
-  ret = mbedtls_mpi_div_int(&gas_big, NULL, &gas_big, 20);
-  if (ret != 0) {
-    return_value = ERROR_MOD_EXP;
-    goto mod_exp_gas_cleanup;
+  if (parse_mod_exp_input(input, input_size, parsed) != 0) {
+    return ERROR_MOD_EXP;
   }
+  const uint64_t base_size = parsed->mod_exp.base_size;
+  const uint64_t mod_size = parsed->mod_exp.mod_size;
 
-  if (mbedtls_mpi_bitlen(&gas_big) > 64) {
-    *target_gas = UINT64_MAX;
+  uint128_t complexity =
+      modexp_mult_complexity(mod_size > base_size ? mod_size : base_size);
+  uint128_t iterations = modexp_iteration_count(parsed);
+  if (iterations < 1) {
+    iterations = 1;
+  }
+  /* complexity < 2^122 and iterations < 2^68, saturate on overflow */
+  uint128_t gas;
+  if (complexity != 0 && iterations > ((uint128_t)0 - 1) / complexity) {
+    gas = (uint128_t)0 - 1;
   } else {
-    ret = mbedtls_mpi_write_binary_le(&gas_big, (unsigned char*)(target_gas), sizeof(uint64_t));
-    if (ret != 0) {
-      return_value = ERROR_MOD_EXP;
-      goto mod_exp_gas_cleanup;
-    }
+    gas = complexity * iterations / 3;
   }
-
- mod_exp_gas_cleanup:
-  mbedtls_mpi_free(&base_len);
-  mbedtls_mpi_free(&exp_len);
-  mbedtls_mpi_free(&mod_len);
-
-  mbedtls_mpi_free(&exp_head);
-  mbedtls_mpi_free(&adj_exp_len);
-  mbedtls_mpi_free(&gas_big);
-  free(content);
-  return return_value;
+  if (gas < 200) {
+    gas = 200;
+  }
+  *target_gas = gas > UINT64_MAX ? UINT64_MAX : (uint64_t)gas;
+  return 0;
 }
 
-/* EIP-2565: Big integer modular exponentiation: false */
+/* EIP-2565: Big integer modular exponentiation: true */
 int big_mod_exp(gw_context_t* ctx,
                 const uint8_t* code_data,
                 const size_t code_size,
                 const enum evmc_call_kind parent_kind,
                 bool is_static_call,
                 const uint8_t* input_src,
-                const size_t input_size, uint8_t** output,
-                size_t* output_size) {
+                const size_t input_size, precompiled_output_t* output,
+                const precompiled_input_t* parsed) {
   int ret;
-  mbedtls_mpi base_len;
-  mbedtls_mpi exp_len;
-  mbedtls_mpi mod_len;
-  size_t base_size;
-  size_t exp_size;
-  size_t mod_size;
-  ret = read_lens(input_src, input_size, &base_len, &exp_len, &mod_len,
-                  &base_size, &exp_size, &mod_size);
-  if (ret != 0) {
-    /* if read_lens() failed, base_len/exp_len/mod_len already freed */
-    return ERROR_MOD_EXP;
+  precompiled_input_t local_parsed;
+  if (parsed == NULL || !parsed->ready) {
+    ret = parse_mod_exp_input(input_src, input_size, &local_parsed);
+    if (ret != 0) {
+      return ERROR_MOD_EXP;
+    }
+    parsed = &local_parsed;
   }
+  const size_t base_size = parsed->mod_exp.base_size;
+  const size_t exp_size = parsed->mod_exp.exp_size;
+  const size_t mod_size = parsed->mod_exp.mod_size;
 
-  if (mbedtls_mpi_cmp_int(&base_len, 0) == 0 &&
-      mbedtls_mpi_cmp_int(&mod_len, 0) == 0) {
-    *output = NULL;
-    *output_size = 0;
-    mbedtls_mpi_free(&base_len);
-    mbedtls_mpi_free(&exp_len);
-    mbedtls_mpi_free(&mod_len);
+  if (base_size == 0 && mod_size == 0) {
+    output->data = NULL;
+    output->size = 0;
     return 0;
   }
 
@@ -446,43 +502,73 @@ int big_mod_exp(gw_context_t* ctx,
   mbedtls_mpi_init(&mod);
   mbedtls_mpi_init(&result);
 
-  const size_t content_size = base_size + exp_size + mod_size;
-  const size_t copy_size = input_size > content_size + 96
-    ? content_size
-    : (input_size > 96 ? input_size - 96 : 0);
-  uint8_t *content = (uint8_t*)malloc(content_size);
-  if (content == NULL) {
-    return_value = FATAL_PRECOMPILED_CONTRACTS;
+  const uint8_t* base_data = parsed->mod_exp.base;
+  const uint8_t* exp_data = parsed->mod_exp.exp;
+  const uint8_t* mod_data = parsed->mod_exp.mod;
+  uint8_t* content = NULL;
+  uint8_t* out = NULL;
+  /* operands cut short by the end of the input read as zero-padded, only
+   * then a padded copy is needed, complete inputs are used in place */
+  if (parsed->mod_exp.base_avail < base_size ||
+      parsed->mod_exp.exp_avail < exp_size ||
+      parsed->mod_exp.mod_avail < mod_size) {
+    if (base_size > SIZE_MAX - exp_size ||
+        base_size + exp_size > SIZE_MAX - mod_size) {
+      return_value = ERROR_MOD_EXP;
+      goto mod_exp_cleanup;
+    }
+    content = (uint8_t*)malloc(base_size + exp_size + mod_size);
+    if (content == NULL) {
+      return_value = FATAL_PRECOMPILED_CONTRACTS;
+      goto mod_exp_cleanup;
+    }
+    memset(content, 0, base_size + exp_size + mod_size);
+    if (parsed->mod_exp.base_avail > 0) {
+      memcpy(content, base_data, parsed->mod_exp.base_avail);
+    }
+    if (parsed->mod_exp.exp_avail > 0) {
+      memcpy(content + base_size, exp_data, parsed->mod_exp.exp_avail);
+    }
+    if (parsed->mod_exp.mod_avail > 0) {
+      memcpy(content + base_size + exp_size, mod_data,
+             parsed->mod_exp.mod_avail);
+    }
+    base_data = content;
+    exp_data = content + base_size;
+    mod_data = content + base_size + exp_size;
+  }
+
+  out = alloc_precompiled_output(output, mod_size);
+  if (out == NULL) {
+    return_value = ERROR_MOD_EXP;
     goto mod_exp_cleanup;
   }
-  memset(content, 0, content_size);
-  memcpy(content, input_src + 96, copy_size);
+  output->size = mod_size;
 
+  /* odd moduli up to 4096 bits: Montgomery engine on stack limbs */
+  if (modexp_fixed_width(base_data, base_size, exp_data, exp_size, mod_data,
+                         mod_size, out)) {
+    goto mod_exp_cleanup;
+  }
 
-  ret = mbedtls_mpi_read_binary(&base, content, base_size);
+  ret = mbedtls_mpi_read_binary(&base, base_data, base_size);
   if (ret != 0) {
     return_value = ERROR_MOD_EXP;
     goto mod_exp_cleanup;
   }
-  ret = mbedtls_mpi_read_binary(&exp, content + base_size, exp_size);
+  ret = mbedtls_mpi_read_binary(&exp, exp_data, exp_size);
   if (ret != 0) {
     return_value = ERROR_MOD_EXP;
     goto mod_exp_cleanup;
   }
-  ret = mbedtls_mpi_read_binary(&mod, content + base_size + exp_size, mod_size);
+  ret = mbedtls_mpi_read_binary(&mod, mod_data, mod_size);
   if (ret != 0) {
     return_value = ERROR_MOD_EXP;
     goto mod_exp_cleanup;
   }
 
-  *output = (uint8_t*)malloc(mod_size);
-  if (*output == NULL) {
-    return_value = ERROR_MOD_EXP;
-    goto mod_exp_cleanup;
-  }
-  *output_size = mod_size;
   if (mbedtls_mpi_bitlen(&mod) == 0) {
-    memset(*output, 0, mod_size);
+    memset(out, 0, mod_size);
     goto mod_exp_cleanup;
   }
 
@@ -491,17 +577,13 @@ int big_mod_exp(gw_context_t* ctx,
     return_value = ERROR_MOD_EXP;
     goto mod_exp_cleanup;
   }
-  ret = mbedtls_mpi_write_binary(&result, *output, mod_size);
+  ret = mbedtls_mpi_write_binary(&result, out, mod_size);
   if (ret != 0) {
     return_value = ERROR_MOD_EXP;
     goto mod_exp_cleanup;
   }
 
  mod_exp_cleanup:
-  mbedtls_mpi_free(&base_len);
-  mbedtls_mpi_free(&exp_len);
-  mbedtls_mpi_free(&mod_len);
-
   mbedtls_mpi_free(&base);
   mbedtls_mpi_free(&exp);
   mbedtls_mpi_free(&mod);
@@ -511,26 +593,9 @@ int big_mod_exp(gw_context_t* ctx,
   return return_value;
 }
 
-static uint8_t precomputed[10][16] = {
-    {0, 2, 4, 6, 1, 3, 5, 7, 8, 10, 12, 14, 9, 11, 13, 15},
-    {14, 4, 9, 13, 10, 8, 15, 6, 1, 0, 11, 5, 12, 2, 7, 3},
-    {11, 12, 5, 15, 8, 0, 2, 13, 10, 3, 7, 9, 14, 6, 1, 4},
-    {7, 3, 13, 11, 9, 1, 12, 14, 2, 5, 4, 15, 6, 10, 0, 8},
-    {9, 5, 2, 10, 0, 7, 4, 15, 14, 11, 6, 3, 1, 12, 8, 13},
-    {2, 6, 0, 8, 12, 10, 11, 3, 4, 7, 15, 1, 13, 5, 14, 9},
-    {12, 1, 14, 4, 5, 15, 13, 10, 0, 6, 9, 8, 7, 3, 2, 11},
-    {13, 7, 12, 3, 11, 14, 1, 9, 5, 15, 8, 2, 0, 4, 6, 10},
-    {6, 14, 11, 0, 15, 9, 3, 8, 12, 13, 1, 10, 2, 7, 4, 5},
-    {10, 8, 7, 1, 2, 4, 6, 5, 15, 9, 3, 13, 11, 14, 12, 0},
-};
-static uint64_t iv[8] = {
-    0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b,
-    0xa54ff53a5f1d36f1, 0x510e527fade682d1, 0x9b05688c2b3e6c1f,
-    0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
-};
-
 int blake2f_required_gas(const uint8_t* input, const size_t input_size,
-                         uint64_t* target_gas) {
+                         uint64_t* target_gas,
+                         precompiled_input_t* parsed) {
   if (input_size != BLAKE2F_INPUT_LENGTH) {
     *target_gas = 0;
     return 0;
@@ -541,164 +606,6 @@ int blake2f_required_gas(const uint8_t* input, const size_t input_size,
   return 0;
 }
 
-uint64_t rotate_left64(uint64_t x, int k) {
-  size_t n = 64;
-  size_t s = (size_t)(k) & (n - 1);
-  return x << s | x >> (n - s);
-}
-
-/* function f_generic is translated from https://github.com/ethereum/go-ethereum/blob/8647233a8ec2a2410a078013ca12c38fdc229866/crypto/blake2b/blake2b_generic.go#L46-L180 */
-void f_generic(uint64_t h[8], uint64_t m[16], uint64_t c0, uint64_t c1,
-               uint64_t flag, uint64_t rounds) {
-  uint64_t v0 = h[0];
-  uint64_t v1 = h[1];
-  uint64_t v2 = h[2];
-  uint64_t v3 = h[3];
-  uint64_t v4 = h[4];
-  uint64_t v5 = h[5];
-  uint64_t v6 = h[6];
-  uint64_t v7 = h[7];
-  uint64_t v8 = iv[0];
-  uint64_t v9 = iv[1];
-  uint64_t v10 = iv[2];
-  uint64_t v11 = iv[3];
-  uint64_t v12 = iv[4];
-  uint64_t v13 = iv[5];
-  uint64_t v14 = iv[6];
-  uint64_t v15 = iv[7];
-  v12 ^= c0;
-  v13 ^= c1;
-  v14 ^= flag;
-
-  for (uint64_t i = 0; i < rounds; i++) {
-    uint8_t* s = precomputed[i % 10];
-
-    v0 += m[s[0]];
-    v0 += v4;
-    v12 ^= v0;
-    v12 = rotate_left64(v12, -32);
-    v8 += v12;
-    v4 ^= v8;
-    v4 = rotate_left64(v4, -24);
-    v1 += m[s[1]];
-    v1 += v5;
-    v13 ^= v1;
-    v13 = rotate_left64(v13, -32);
-    v9 += v13;
-    v5 ^= v9;
-    v5 = rotate_left64(v5, -24);
-    v2 += m[s[2]];
-    v2 += v6;
-    v14 ^= v2;
-    v14 = rotate_left64(v14, -32);
-    v10 += v14;
-    v6 ^= v10;
-    v6 = rotate_left64(v6, -24);
-    v3 += m[s[3]];
-    v3 += v7;
-    v15 ^= v3;
-    v15 = rotate_left64(v15, -32);
-    v11 += v15;
-    v7 ^= v11;
-    v7 = rotate_left64(v7, -24);
-
-    v0 += m[s[4]];
-    v0 += v4;
-    v12 ^= v0;
-    v12 = rotate_left64(v12, -16);
-    v8 += v12;
-    v4 ^= v8;
-    v4 = rotate_left64(v4, -63);
-    v1 += m[s[5]];
-    v1 += v5;
-    v13 ^= v1;
-    v13 = rotate_left64(v13, -16);
-    v9 += v13;
-    v5 ^= v9;
-    v5 = rotate_left64(v5, -63);
-    v2 += m[s[6]];
-    v2 += v6;
-    v14 ^= v2;
-    v14 = rotate_left64(v14, -16);
-    v10 += v14;
-    v6 ^= v10;
-    v6 = rotate_left64(v6, -63);
-    v3 += m[s[7]];
-    v3 += v7;
-    v15 ^= v3;
-    v15 = rotate_left64(v15, -16);
-    v11 += v15;
-    v7 ^= v11;
-    v7 = rotate_left64(v7, -63);
-
-    v0 += m[s[8]];
-    v0 += v5;
-    v15 ^= v0;
-    v15 = rotate_left64(v15, -32);
-    v10 += v15;
-    v5 ^= v10;
-    v5 = rotate_left64(v5, -24);
-    v1 += m[s[9]];
-    v1 += v6;
-    v12 ^= v1;
-    v12 = rotate_left64(v12, -32);
-    v11 += v12;
-    v6 ^= v11;
-    v6 = rotate_left64(v6, -24);
-    v2 += m[s[10]];
-    v2 += v7;
-    v13 ^= v2;
-    v13 = rotate_left64(v13, -32);
-    v8 += v13;
-    v7 ^= v8;
-    v7 = rotate_left64(v7, -24);
-    v3 += m[s[11]];
-    v3 += v4;
-    v14 ^= v3;
-    v14 = rotate_left64(v14, -32);
-    v9 += v14;
-    v4 ^= v9;
-    v4 = rotate_left64(v4, -24);
-
-    v0 += m[s[12]];
-    v0 += v5;
-    v15 ^= v0;
-    v15 = rotate_left64(v15, -16);
-    v10 += v15;
-    v5 ^= v10;
-    v5 = rotate_left64(v5, -63);
-    v1 += m[s[13]];
-    v1 += v6;
-    v12 ^= v1;
-    v12 = rotate_left64(v12, -16);
-    v11 += v12;
-    v6 ^= v11;
-    v6 = rotate_left64(v6, -63);
-    v2 += m[s[14]];
-    v2 += v7;
-    v13 ^= v2;
-    v13 = rotate_left64(v13, -16);
-    v8 += v13;
-    v7 ^= v8;
-    v7 = rotate_left64(v7, -63);
-    v3 += m[s[15]];
-    v3 += v4;
-    v14 ^= v3;
-    v14 = rotate_left64(v14, -16);
-    v9 += v14;
-    v4 ^= v9;
-    v4 = rotate_left64(v4, -63);
-  }
-  h[0] ^= v0 ^ v8;
-  h[1] ^= v1 ^ v9;
-  h[2] ^= v2 ^ v10;
-  h[3] ^= v3 ^ v11;
-  h[4] ^= v4 ^ v12;
-  h[5] ^= v5 ^ v13;
-  h[6] ^= v6 ^ v14;
-  h[7] ^= v7 ^ v15;
-}
-
 /* https://eips.ethereum.org/EIPS/eip-152 */
 int blake2f(gw_context_t* ctx,
             const uint8_t* code_data,
@@ -706,7 +613,8 @@ int blake2f(gw_context_t* ctx,
             const enum evmc_call_kind parent_kind,
             bool is_static_call,
             const uint8_t* input_src,
-            const size_t input_size, uint8_t** output, size_t* output_size) {
+            const size_t input_size, precompiled_output_t* output,
+            const precompiled_input_t* parsed) {
   if (input_size != BLAKE2F_INPUT_LENGTH) {
     return ERROR_BLAKE2F_INVALID_INPUT_LENGTH;
   }
@@ -734,17 +642,16 @@ int blake2f(gw_context_t* ctx,
   memcpy(&t[1], input_src + 204, sizeof(uint64_t));
 
   uint64_t flag = final ? 0xFFFFFFFFFFFFFFFF : 0;
-  /* TODO: maybe improve performance */
-  f_generic(h, m, t[0], t[1], flag, (uint64_t)rounds);
+  blake2f_compress(h, m, t[0], t[1], flag, (uint64_t)rounds);
 
-  *output = (uint8_t*)malloc(64);
-  if (*output == NULL) {
+  uint8_t* out = alloc_precompiled_output(output, 64);
+  if (out == NULL) {
     return FATAL_PRECOMPILED_CONTRACTS;
   }
-  *output_size = 64;
+  output->size = 64;
   for (size_t i = 0; i < 8; i++) {
     size_t offset = i * 8;
-    memcpy(*output + offset, (uint8_t*)(&h[i]), 8);
+    memcpy(out + offset, (uint8_t*)(&h[i]), 8);
   }
   return 0;
 }
@@ -752,7 +659,8 @@ int blake2f(gw_context_t* ctx,
 /* bn256AddIstanbul */
 int bn256_add_istanbul_gas(const uint8_t* input_src,
                            const size_t input_size,
-                           uint64_t* gas) {
+                           uint64_t* gas,
+                           precompiled_input_t* parsed) {
   *gas = BN256_ADD_GAS_ISTANBUL;
   return 0;
 }
@@ -776,24 +684,26 @@ int bn256_add_istanbul(gw_context_t *ctx,
                        bool is_static_call,
                        const uint8_t *input_src,
                        const size_t input_size,
-                       uint8_t **output, size_t *output_size) {
+                       precompiled_output_t* output,
+                       const precompiled_input_t* parsed) {
   const size_t OUTPUT_LEN = 64;
-  *output = (uint8_t *)malloc(OUTPUT_LEN);
-  if (*output == NULL) {
+  uint8_t *out = alloc_precompiled_output(output, OUTPUT_LEN);
+  if (out == NULL) {
     return FATAL_PRECOMPILED_CONTRACTS;
   }
 
-  if (ctx->sys_bn_add(input_src, input_size, *output) != 0) {
+  if (ctx->sys_bn_add(input_src, input_size, out) != 0) {
     return ERROR_BN256_ADD;
   }
-  *output_size = OUTPUT_LEN;
+  output->size = OUTPUT_LEN;
   return 0;
 }
 
 /* bn256ScalarMulIstanbul */
 int bn256_scalar_mul_istanbul_gas(const uint8_t* input_src,
                                   const size_t input_size,
-                                  uint64_t* gas) {
+                                  uint64_t* gas,
+                                  precompiled_input_t* parsed) {
   *gas = BN256_SCALAR_MUL_GAS_ISTANBUL;
   return 0;
 }
@@ -817,24 +727,26 @@ int bn256_scalar_mul_istanbul(gw_context_t *ctx,
                               bool is_static_call,
                               const uint8_t *input_src,
                               const size_t input_size,
-                              uint8_t **output, size_t *output_size) {
+                              precompiled_output_t* output,
+                              const precompiled_input_t* parsed) {
   const size_t OUTPUT_LEN = 64;
-  *output = (uint8_t *)malloc(OUTPUT_LEN);
-  if (*output == NULL) {
+  uint8_t *out = alloc_precompiled_output(output, OUTPUT_LEN);
+  if (out == NULL) {
     return FATAL_PRECOMPILED_CONTRACTS;
   }
 
-  if (ctx->sys_bn_mul(input_src, input_size, *output) != 0) {
+  if (ctx->sys_bn_mul(input_src, input_size, out) != 0) {
     return ERROR_BN256_SCALAR_MUL;
   }
-  *output_size = OUTPUT_LEN;
+  output->size = OUTPUT_LEN;
   return 0;
 }
 
 /* bn256PairingIstanbul */
 int bn256_pairing_istanbul_gas(const uint8_t* input_src,
                                const size_t input_size,
-                               uint64_t* gas) {
+                               uint64_t* gas,
+                               precompiled_input_t* parsed) {
   *gas = BN256_PAIRING_BASE_GAS_ISTANBUL
     + ((uint64_t)input_size / 192 * BN256_PAIRING_PERPOINT_GAS_ISTANBUL);
   return 0;
@@ -852,20 +764,97 @@ int bn256_pairing_istanbul(gw_context_t *ctx,
                            bool is_static_call,
                            const uint8_t *input_src,
                            const size_t input_size,
-                           uint8_t **output, size_t *output_size) {
+                           precompiled_output_t* output,
+                           const precompiled_input_t* parsed) {
   const size_t OUTPUT_LEN = 32;
-  *output = (uint8_t *)malloc(OUTPUT_LEN);
-  if (*output == NULL) {
+  uint8_t *out = alloc_precompiled_output(output, OUTPUT_LEN);
+  if (out == NULL) {
     return FATAL_PRECOMPILED_CONTRACTS;
   }
 
-  if (0 != ctx->sys_bn_pairing(input_src, input_size, *output)) {
+  if (0 != ctx->sys_bn_pairing(input_src, input_size, out)) {
     return ERROR_BN256_PAIRING;
   }
-  *output_size = OUTPUT_LEN;
+  output->size = OUTPUT_LEN;
   return 0;
 }
 
+/**
+ * Dispatch entry of a pre-compiled contract
+ *
+ * - static_safe: never writes state, call() fails it under STATICCALL
+ *   otherwise
+ * - pure: the output and gas depend only on the input bytes
+ * - max_output_size: upper bound of the output size in bytes, 0 when it
+ *   depends on the input, a larger output is a fatal error in call()
+ */
+typedef struct {
+  precompiled_contract_gas_fn contract_gas;
+  precompiled_contract_fn contract;
+  bool static_safe;
+  bool pure;
+  uint32_t max_output_size;
+} precompiled_contract_t;
+
+typedef struct {
+  precompiled_contract_t entries[256];
+} precompiled_contract_table_t;
+
+/* indexed by the last address byte, contract == NULL for a free slot */
+constexpr precompiled_contract_table_t build_precompiled_contract_table() {
+  precompiled_contract_table_t table = {};
+  table.entries[0x01] = {ecrecover_required_gas, ecrecover, true, true, 32};
+  table.entries[0x02] = {sha256hash_required_gas, sha256hash, true, true, 32};
+  table.entries[0x03] = {ripemd160hash_required_gas, ripemd160hash, true, true,
+                         32};
+  table.entries[0x04] = {data_copy_required_gas, data_copy, true, true, 0};
+  table.entries[0x05] = {big_mod_exp_required_gas, big_mod_exp, true, true, 0};
+  table.entries[0x06] = {bn256_add_istanbul_gas, bn256_add_istanbul, true,
+                         true, 64};
+  table.entries[0x07] = {bn256_scalar_mul_istanbul_gas,
+                         bn256_scalar_mul_istanbul, true, true, 64};
+  table.entries[0x08] = {bn256_pairing_istanbul_gas, bn256_pairing_istanbul,
+                         true, true, 32};
+  table.entries[0x09] = {blake2f_required_gas, blake2f, true, true, 64};
+  table.entries[0xf0] = {balance_of_any_sudt_gas, balance_of_any_sudt, true,
+                         false, 32};
+  table.entries[0xf1] = {transfer_to_any_sudt_gas, transfer_to_any_sudt,
+                         false, false, 0};
+  table.entries[0xf2] = {recover_account_gas, recover_account, true, false,
+                         32};
+  // Use gw_get_script_hash_by_registry_address RPC instead of this precompiled contract
+  // Deprecated 0xf3: eth_addr_to_gw_script_hash
+  table.entries[0xf4] = {total_supply_of_any_sudt_gas, total_supply_of_any_sudt,
+                         true, false, 32};
+  table.entries[0xf5] = {batch_ecrecover_gas, batch_ecrecover, true, true, 0};
+  return table;
+}
+
+static constexpr precompiled_contract_table_t g_precompiled_contracts =
+    build_precompiled_contract_table();
+
+/**
+ * @brief Lookup the pre-compiled contract at destination
+ * @return the dispatch entry, or NULL if destination is not 0x00..00XX or no
+ *         contract lives at XX
+ * @see - https://www.evm.codes/precompiled
+ */
+const precompiled_contract_t*
+lookup_precompiled_contract(const evmc_address* destination) {
+  /* bytes[0..19] must be zero: one 16-byte and one 4-byte word (the latter
+   * overlapping byte 15), folded without a branch per byte */
+  uint64_t head[2];
+  uint32_t tail;
+  memcpy(head, destination->bytes, sizeof(head));
+  memcpy(&tail, destination->bytes + 15, sizeof(tail));
+  if ((head[0] | head[1] | tail) != 0) {
+    return NULL;
+  }
+  const precompiled_contract_t* entry =
+      &g_precompiled_contracts.entries[destination->bytes[19]];
+  return entry->contract == NULL ? NULL : entry;
+}
+
 /**
  * @brief Match Precompiled Contracts
  * @see - https://www.evm.codes/precompiled
@@ -873,75 +862,15 @@ int bn256_pairing_istanbul(gw_context_t *ctx,
 bool match_precompiled_address(const evmc_address* destination,
                                precompiled_contract_gas_fn* contract_gas,
                                precompiled_contract_fn* contract) {
-  for (int i = 0; i < 19; i++) {
-    if (destination->bytes[i] != 0) {
-      return false;
-    }
-  }
-
-  switch (destination->bytes[19]) {
-  case 1:
-    *contract_gas = ecrecover_required_gas;
-    *contract = ecrecover;
-    break;
-  case 2:
-    *contract_gas = sha256hash_required_gas;
-    *contract = sha256hash;
-    break;
-  case 3:
-    *contract_gas = ripemd160hash_required_gas;
-    *contract = ripemd160hash;
-    break;
-  case 4:
-    *contract_gas = data_copy_required_gas;
-    *contract = data_copy;
-    break;
-  case 5:
-    *contract_gas = big_mod_exp_required_gas;
-    *contract = big_mod_exp;
-    break;
-  case 6:
-    *contract_gas = bn256_add_istanbul_gas;
-    *contract = bn256_add_istanbul;
-    break;
-  case 7:
-    *contract_gas = bn256_scalar_mul_istanbul_gas;
-    *contract = bn256_scalar_mul_istanbul;
-    break;
-  case 8:
-    *contract_gas = bn256_pairing_istanbul_gas;
-    *contract = bn256_pairing_istanbul;
-    break;
-  case 9:
-    *contract_gas = blake2f_required_gas;
-    *contract = blake2f;
-    break;
-  case 0xf0:
-    *contract_gas = balance_of_any_sudt_gas;
-    *contract = balance_of_any_sudt;
-    break;
-  case 0xf1:
-    *contract_gas = transfer_to_any_sudt_gas;
-    *contract = transfer_to_any_sudt;
-    break;
-  case 0xf2:
-    *contract_gas = recover_account_gas;
-    *contract = recover_account;
-    break;
-  // Use gw_get_script_hash_by_registry_address RPC instead of this precompiled contract
-  // Deprecated case 0xf3:
-  //   *contract_gas = eth_addr_to_gw_script_hash_gas;
-  //   *contract = eth_addr_to_gw_script_hash;
-  //   break;
-  case 0xf4:
-    *contract_gas = total_supply_of_any_sudt_gas;
-    *contract = total_supply_of_any_sudt;
-    break;
-  default:
+  const precompiled_contract_t* entry =
+      lookup_precompiled_contract(destination);
+  if (entry == NULL) {
     *contract_gas = NULL;
     *contract = NULL;
     return false;
   }
+  *contract_gas = entry->contract_gas;
+  *contract = entry->contract;
   return true;
 }
 
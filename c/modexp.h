@@ -0,0 +1,258 @@
+#ifndef MODEXP_H_
+#define MODEXP_H_
+
+/*
+ * Fixed-width Montgomery modular exponentiation for the bigModExp
+ * precompile (0x05).
+ *
+ * Operands live in stack arrays of N 64-bit limbs, with N picked from the
+ * buckets 256/512/1024/2048/4096 bits by the larger of the (leading-zero
+ * stripped) base and modulus. Exponentiation is left-to-right sliding
+ * window over the big-endian exponent bytes, read in place. Even moduli
+ * and operands wider than 4096 bits are not handled here,
+ * modexp_fixed_width() returns false and the caller falls back to mbedtls.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* the largest window keeps the 4096-bit power table at 8KB of stack */
+#define MODEXP_MAX_WINDOW_BITS 5
+#define MODEXP_MAX_LIMBS 64
+
+/* -n^-1 mod 2^64 by Newton iteration, n0 must be odd */
+static uint64_t modexp_mont_n0inv(uint64_t n0) {
+  uint64_t inv = n0; /* correct to 3 bits for odd n0 */
+  for (int i = 0; i < 5; i++) {
+    inv *= 2 - n0 * inv;
+  }
+  return (uint64_t)0 - inv;
+}
+
+/* r = a * b * R^-1 mod n (CIOS), requires a * b < n * R; r may alias a/b */
+template <size_t N>
+static void modexp_mont_mul(uint64_t r[N], const uint64_t a[N],
+                            const uint64_t b[N], const uint64_t n[N],
+                            uint64_t n0inv) {
+  uint64_t t[N + 2];
+  memset(t, 0, sizeof(t));
+  for (size_t i = 0; i < N; i++) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < N; j++) {
+      uint128_t p = (uint128_t)a[i] * b[j] + t[j] + carry;
+      t[j] = (uint64_t)p;
+      carry = (uint64_t)(p >> 64);
+    }
+    uint128_t s = (uint128_t)t[N] + carry;
+    t[N] = (uint64_t)s;
+    t[N + 1] = (uint64_t)(s >> 64);
+
+    uint64_t m = t[0] * n0inv;
+    uint128_t p = (uint128_t)m * n[0] + t[0];
+    carry = (uint64_t)(p >> 64);
+    for (size_t j = 1; j < N; j++) {
+      p = (uint128_t)m * n[j] + t[j] + carry;
+      t[j - 1] = (uint64_t)p;
+      carry = (uint64_t)(p >> 64);
+    }
+    s = (uint128_t)t[N] + carry;
+    t[N - 1] = (uint64_t)s;
+    t[N] = t[N + 1] + (uint64_t)(s >> 64);
+  }
+
+  /* t < 2n, subtract n once if t >= n */
+  uint64_t d[N];
+  uint64_t borrow = 0;
+  for (size_t j = 0; j < N; j++) {
+    uint128_t diff = (uint128_t)t[j] - n[j] - borrow;
+    d[j] = (uint64_t)diff;
+    borrow = (uint64_t)(diff >> 64) & 1;
+  }
+  if (t[N] != 0 || borrow == 0) {
+    memcpy(r, d, sizeof(d));
+  } else {
+    memcpy(r, t, sizeof(uint64_t) * N);
+  }
+}
+
+/* x = 2x mod n, requires x < n */
+template <size_t N>
+static void modexp_double_mod(uint64_t x[N], const uint64_t n[N]) {
+  uint64_t top = x[N - 1] >> 63;
+  for (size_t j = N - 1; j > 0; j--) {
+    x[j] = (x[j] << 1) | (x[j - 1] >> 63);
+  }
+  x[0] <<= 1;
+
+  uint64_t d[N];
+  uint64_t borrow = 0;
+  for (size_t j = 0; j < N; j++) {
+    uint128_t diff = (uint128_t)x[j] - n[j] - borrow;
+    d[j] = (uint64_t)diff;
+    borrow = (uint64_t)(diff >> 64) & 1;
+  }
+  if (top != 0 || borrow == 0) {
+    memcpy(x, d, sizeof(d));
+  }
+}
+
+/* little-endian limbs from big-endian bytes, len <= 8 * limbs */
+static void modexp_load_be(uint64_t* limbs, size_t limb_count,
+                           const uint8_t* bytes, size_t len) {
+  memset(limbs, 0, limb_count * sizeof(uint64_t));
+  for (size_t i = 0; i < len; i++) {
+    limbs[i / 8] |= (uint64_t)bytes[len - 1 - i] << (8 * (i % 8));
+  }
+}
+
+static size_t modexp_bitlen(const uint64_t* limbs, size_t limb_count) {
+  for (size_t i = limb_count; i > 0; i--) {
+    if (limbs[i - 1] != 0) {
+      return (i - 1) * 64 + 64 - __builtin_clzll(limbs[i - 1]);
+    }
+  }
+  return 0;
+}
+
+static int modexp_exp_bit(const uint8_t* exp, size_t exp_size,
+                          size_t bit) {
+  return (exp[exp_size - 1 - bit / 8] >> (bit % 8)) & 1;
+}
+
+template <size_t N>
+static void modexp_mont_exp(const uint8_t* base, size_t base_size,
+                            const uint8_t* exp, size_t exp_size,
+                            const uint64_t n[N], uint8_t* out,
+                            size_t out_size) {
+  const uint64_t n0inv = modexp_mont_n0inv(n[0]);
+  const size_t n_bits = modexp_bitlen(n, N);
+
+  /* one = R mod n, starting from 2^(bits - 1) < n (n is odd and > 1) */
+  uint64_t one[N];
+  memset(one, 0, sizeof(one));
+  one[(n_bits - 1) / 64] = (uint64_t)1 << ((n_bits - 1) % 64);
+  for (size_t i = n_bits - 1; i < N * 64; i++) {
+    modexp_double_mod<N>(one, n);
+  }
+
+  /* rr = R^2 mod n: Montgomery form of 2, squared log2(64N) times */
+  uint64_t rr[N];
+  memcpy(rr, one, sizeof(rr));
+  modexp_double_mod<N>(rr, n);
+  for (size_t bits = 1; bits < N * 64; bits <<= 1) {
+    modexp_mont_mul<N>(rr, rr, rr, n, n0inv);
+  }
+
+  /* exponent bit length, leading zero bytes are skipped */
+  size_t exp_bits = 0;
+  for (size_t i = 0; i < exp_size; i++) {
+    if (exp[i] != 0) {
+      exp_bits = (exp_size - i) * 8 - __builtin_clz((uint32_t)exp[i]) + 24;
+      break;
+    }
+  }
+
+  uint64_t acc[N];
+  memcpy(acc, one, sizeof(acc));
+  if (exp_bits > 0) {
+    size_t window = exp_bits > 239 ? 5 : exp_bits > 79 ? 4
+                    : exp_bits > 23 ? 3 : 1;
+    if (window > MODEXP_MAX_WINDOW_BITS) {
+      window = MODEXP_MAX_WINDOW_BITS;
+    }
+
+    /* odd powers base^1, base^3, ..., base^(2^window - 1) */
+    uint64_t table[1 << (MODEXP_MAX_WINDOW_BITS - 1)][N];
+    uint64_t b[N];
+    modexp_load_be(b, N, base, base_size);
+    modexp_mont_mul<N>(table[0], b, rr, n, n0inv);
+    if (window > 1) {
+      uint64_t sq[N];
+      modexp_mont_mul<N>(sq, table[0], table[0], n, n0inv);
+      for (size_t i = 1; i < ((size_t)1 << (window - 1)); i++) {
+        modexp_mont_mul<N>(table[i], table[i - 1], sq, n, n0inv);
+      }
+    }
+
+    size_t i = exp_bits;
+    while (i > 0) {
+      if (!modexp_exp_bit(exp, exp_size, i - 1)) {
+        modexp_mont_mul<N>(acc, acc, acc, n, n0inv);
+        i--;
+        continue;
+      }
+      /* longest window ending in a set bit */
+      size_t len = i < window ? i : window;
+      while (!modexp_exp_bit(exp, exp_size, i - len)) {
+        len--;
+      }
+      size_t value = 0;
+      for (size_t k = 0; k < len; k++) {
+        value = (value << 1) | modexp_exp_bit(exp, exp_size, i - 1 - k);
+        modexp_mont_mul<N>(acc, acc, acc, n, n0inv);
+      }
+      modexp_mont_mul<N>(acc, acc, table[value >> 1], n, n0inv);
+      i -= len;
+    }
+  }
+
+  /* leave the Montgomery domain */
+  uint64_t unit[N];
+  memset(unit, 0, sizeof(unit));
+  unit[0] = 1;
+  modexp_mont_mul<N>(acc, acc, unit, n, n0inv);
+
+  memset(out, 0, out_size);
+  for (size_t i = 0; i < N * 8 && i < out_size; i++) {
+    out[out_size - 1 - i] = (uint8_t)(acc[i / 8] >> (8 * (i % 8)));
+  }
+}
+
+/*
+ * out = base^exp mod mod as a mod_size big-endian value. Returns false when
+ * the operands are outside what this engine handles (even modulus, modulus
+ * of 0 or 1, or more than MODEXP_MAX_LIMBS limbs) and nothing was written.
+ */
+bool modexp_fixed_width(const uint8_t* base, size_t base_size,
+                        const uint8_t* exp, size_t exp_size,
+                        const uint8_t* mod, size_t mod_size, uint8_t* out) {
+  while (base_size > 0 && base[0] == 0) {
+    base++;
+    base_size--;
+  }
+  size_t mod_bytes = mod_size;
+  const uint8_t* mod_start = mod;
+  while (mod_bytes > 0 && mod_start[0] == 0) {
+    mod_start++;
+    mod_bytes--;
+  }
+  if (mod_bytes == 0 || (mod_start[mod_bytes - 1] & 1) == 0 ||
+      (mod_bytes == 1 && mod_start[0] == 1)) {
+    return false;
+  }
+
+  size_t width = base_size > mod_bytes ? base_size : mod_bytes;
+  uint64_t n[MODEXP_MAX_LIMBS];
+  if (width <= 32) {
+    modexp_load_be(n, 4, mod_start, mod_bytes);
+    modexp_mont_exp<4>(base, base_size, exp, exp_size, n, out, mod_size);
+  } else if (width <= 64) {
+    modexp_load_be(n, 8, mod_start, mod_bytes);
+    modexp_mont_exp<8>(base, base_size, exp, exp_size, n, out, mod_size);
+  } else if (width <= 128) {
+    modexp_load_be(n, 16, mod_start, mod_bytes);
+    modexp_mont_exp<16>(base, base_size, exp, exp_size, n, out, mod_size);
+  } else if (width <= 256) {
+    modexp_load_be(n, 32, mod_start, mod_bytes);
+    modexp_mont_exp<32>(base, base_size, exp, exp_size, n, out, mod_size);
+  } else if (width <= 512) {
+    modexp_load_be(n, 64, mod_start, mod_bytes);
+    modexp_mont_exp<64>(base, base_size, exp, exp_size, n, out, mod_size);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#endif /* MODEXP_H_ */
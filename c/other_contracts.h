@@ -9,7 +9,8 @@
 
 int recover_account_gas(const uint8_t* input_src,
                         const size_t input_size,
-                        uint64_t* gas) {
+                        uint64_t* gas,
+                        precompiled_input_t* parsed) {
   *gas = RECOVER_ACCOUNT_GAS;
   return 0;
 }
@@ -35,7 +36,8 @@ int recover_account(gw_context_t* ctx,
                     bool is_static_call,
                     const uint8_t* input_src,
                     const size_t input_size,
-                    uint8_t** output, size_t* output_size) {
+                    precompiled_output_t* output,
+                    const precompiled_input_t* parsed) {
   if (input_size < 128) {
     debug_print_int("input size too small", input_size);
     return ERROR_RECOVER_ACCOUNT;
@@ -66,13 +68,13 @@ int recover_account(gw_context_t* ctx,
       return ERROR_RECOVER_ACCOUNT;
     }
   }
-  *output = (uint8_t *)malloc(32);
-  if (*output == NULL) {
+  uint8_t *out = alloc_precompiled_output(output, 32);
+  if (out == NULL) {
     ckb_debug("malloc failed");
     return FATAL_PRECOMPILED_CONTRACTS;
   }
-  *output_size = 32;
-  blake2b_hash(*output, script, script_len);
+  output->size = 32;
+  blake2b_hash(out, script, script_len);
   return 0;
 }
 
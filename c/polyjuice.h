@@ -10,6 +10,8 @@
 #include <evmc/evmc.h>
 #include <evmc/evmc.hpp>
 #include <evmone/evmone.h>
+#include "analysis.hpp"
+#include "execution.hpp"
 
 #include "uint256.h"
 
@@ -44,6 +46,14 @@
 #define POLYJUICE_SYSTEM_PREFIX 0xFF
 #define POLYJUICE_CONTRACT_CODE 0x01
 #define POLYJUICE_DESTRUCTED 0x02
+/* keccak256(contract code), returned by EXTCODEHASH */
+#define POLYJUICE_CONTRACT_CODE_HASH 0x03
+/* length of contract code as uint32_t (little endian) followed by
+ * CODE_SIZE_PRESENT, so that a stored length of 0 is told apart from a
+ * missing key */
+#define POLYJUICE_CONTRACT_CODE_SIZE 0x04
+#define CODE_SIZE_PRESENT_OFFSET 4
+#define CODE_SIZE_PRESENT 0x01
 
 void polyjuice_build_system_key(uint32_t id, uint8_t polyjuice_field_type,
                                 uint8_t key[GW_KEY_BYTES]) {
@@ -59,6 +69,14 @@ void polyjuice_build_contract_code_key(uint32_t id, uint8_t key[GW_KEY_BYTES]) {
 void polyjuice_build_destructed_key(uint32_t id, uint8_t key[GW_KEY_BYTES]) {
   polyjuice_build_system_key(id, POLYJUICE_DESTRUCTED, key);
 }
+void polyjuice_build_contract_code_hash_key(uint32_t id,
+                                            uint8_t key[GW_KEY_BYTES]) {
+  polyjuice_build_system_key(id, POLYJUICE_CONTRACT_CODE_HASH, key);
+}
+void polyjuice_build_contract_code_size_key(uint32_t id,
+                                            uint8_t key[GW_KEY_BYTES]) {
+  polyjuice_build_system_key(id, POLYJUICE_CONTRACT_CODE_SIZE, key);
+}
 
 /* assume `account_id` already exists */
 int gw_increase_nonce(gw_context_t *ctx, uint32_t account_id, uint32_t *new_nonce) {
@@ -128,6 +146,58 @@ int load_account_script(gw_context_t* gw_ctx, uint32_t account_id,
   return 0;
 }
 
+/**
+   AccessList = [
+     address_count : u32             (little endian)
+     [
+       address     : [u8; 20]
+       key_count   : u32             (little endian)
+       keys        : [[u8; 32]; key_count]
+     ]; address_count
+   ]
+
+   Validate the access list and count its addresses and storage keys.
+ */
+int parse_access_list(const uint8_t* data, size_t len) {
+  if (len < 4) {
+    return -1;
+  }
+  uint32_t address_count;
+  memcpy(&address_count, data, sizeof(uint32_t));
+  size_t offset = 4;
+  uint64_t key_total = 0;
+  for (uint32_t i = 0; i < address_count; i++) {
+    if (len - offset < ETH_ADDRESS_LEN + 4) {
+      return -1;
+    }
+    uint32_t key_count;
+    memcpy(&key_count, data + offset + ETH_ADDRESS_LEN, sizeof(uint32_t));
+    offset += ETH_ADDRESS_LEN + 4;
+    if ((len - offset) / 32 < key_count) {
+      return -1;
+    }
+    offset += (size_t)key_count * 32;
+    key_total += key_count;
+  }
+  if (offset != len) {
+    return -1;
+  }
+  g_access_list = data;
+  g_access_list_addresses = address_count;
+  g_access_list_storage_keys = (uint32_t)key_total;
+  return 0;
+}
+
+/**
+ * Set in the call_kind byte of the args of a transaction signed as an
+ * EIP-2930 (type 1) transaction, whose signature covers the access list.
+ * Only such transactions carry an access list, so it can not be appended to
+ * the args of a legacy transaction, which the signature does not cover. The
+ * ETH account lock must verify the flagged args against the type 1 signing
+ * payload, and reject them if it does not know the flag.
+ */
+#define POLYJUICE_ARGS_ACCESS_LIST 0x80
+
 // TODO: change gas_limit, gas_price, value to u256
 /**
    Message = [
@@ -138,10 +208,17 @@ int load_account_script(gw_context_t* gw_ctx, uint32_t account_id,
      input_size : u32                (little endian)
      input_data : [u8; input_size]
      to_address : [u8; 20]	     optional, must be an EOA 
+     access_list: AccessList         only and always with the
+                                     POLYJUICE_ARGS_ACCESS_LIST flag, which
+                                     is not allowed with to_address
    ]
  */
 int parse_args(struct evmc_message* msg, gw_context_t* ctx) {
+  int ret;
   gw_transaction_context_t *tx_ctx = &ctx->transaction_context;
+  g_access_list = NULL;
+  g_access_list_addresses = 0;
+  g_access_list_storage_keys = 0;
   debug_print_int("args_len", tx_ctx->args_len);
   if (tx_ctx->args_len < (8 + 8 + 16 + 16 + 4)) {
     ckb_debug("invalid polyjuice arguments data");
@@ -162,11 +239,13 @@ int parse_args(struct evmc_message* msg, gw_context_t* ctx) {
     return -1;
   }
   debug_print_int("[call_kind]", args[7]);
-  if (args[7] != EVMC_CALL && args[7] != EVMC_CREATE) {
+  bool has_access_list = (args[7] & POLYJUICE_ARGS_ACCESS_LIST) != 0;
+  uint8_t call_kind = args[7] & ~POLYJUICE_ARGS_ACCESS_LIST;
+  if (call_kind != EVMC_CALL && call_kind != EVMC_CREATE) {
     ckb_debug("invalid call kind");
     return -1;
   }
-  evmc_call_kind kind = (evmc_call_kind)args[7];
+  evmc_call_kind kind = (evmc_call_kind)call_kind;
   offset += 8;
 
   /* args[8..16] gas limit  */
@@ -201,8 +280,20 @@ int parse_args(struct evmc_message* msg, gw_context_t* ctx) {
   /* args[52..52+input_size] */
   uint8_t* input_data = args + offset;
   offset += input_size;
+  if (offset > tx_ctx->args_len) {
+    ckb_debug("invalid polyjuice transaction");
+    return -1;
+  }
  
-  if (offset + 20 == tx_ctx->args_len) { // This is a transfer tx.
+  if (has_access_list) {
+    ret = parse_access_list(args + offset, tx_ctx->args_len - offset);
+    if (ret != 0) {
+      ckb_debug("invalid polyjuice transaction");
+      return -1;
+    }
+    debug_print_int("[access_list] addresses", g_access_list_addresses);
+    debug_print_int("[access_list] storage keys", g_access_list_storage_keys);
+  } else if (offset + 20 == tx_ctx->args_len) { // This is a transfer tx.
     if (kind != EVMC_CALL) {
         ckb_debug("Native token transfer transaction only accepts CALL.");
         return -1;
@@ -228,14 +319,97 @@ int parse_args(struct evmc_message* msg, gw_context_t* ctx) {
 }
 
 void release_result(const struct evmc_result* result) {
-  if (result->output_data != NULL) {
-    free((void*)result->output_data);
-  }
+  tx_free(result->output_data);
   return;
 }
 
-int load_account_code(gw_context_t* gw_ctx, uint32_t account_id,
-                      uint64_t* code_size, uint64_t offset, uint8_t* code) {
+/**
+ * Per-transaction contract code cache
+ *
+ * Every host callback that needs the code of an account goes through
+ * `load_account_code`, so each account script is verified and each contract
+ * code is copied out of Godwoken at most once per `run_polyjuice()`.
+ *
+ * An entry returned by `load_account_code` is pinned until it is passed to
+ * `release_account_code`, so a frame executing a contract never sees its code
+ * evicted underneath it. When every slot is pinned, an uncached entry is
+ * allocated instead and freed on release.
+ */
+#define CODE_CACHE_CAPACITY 32
+
+typedef struct {
+  uint32_t account_id;
+  /* false once invalidated, or for an uncached entry */
+  bool valid;
+  bool cached;
+  /* the account is a Polyjuice contract of the current creator account */
+  bool is_contract;
+  /* `code` is only filled by `load_account_code` */
+  bool code_loaded;
+  /* `code_size` is known, see `load_account_code_size` */
+  bool has_code_size;
+  bool has_code_hash;
+  uint32_t pins;
+  uint8_t data_hash[32];
+  /* keccak256 of the code, see `load_account_code_hash` */
+  uint8_t code_hash[32];
+  uint64_t code_size;
+  uint8_t* code;
+} account_code_t;
+
+static account_code_t g_code_cache[CODE_CACHE_CAPACITY];
+static uint32_t g_code_cache_cursor = 0;
+
+void clear_account_code(account_code_t* entry) {
+  free(entry->code);
+  memset(entry, 0, sizeof(account_code_t));
+}
+
+void init_code_cache() {
+  for (size_t i = 0; i < CODE_CACHE_CAPACITY; i++) {
+    clear_account_code(&g_code_cache[i]);
+  }
+  g_code_cache_cursor = 0;
+}
+
+/* Drop the cached code of `account_id` after the account was (re)created */
+void invalidate_account_code(uint32_t account_id) {
+  for (size_t i = 0; i < CODE_CACHE_CAPACITY; i++) {
+    account_code_t* entry = &g_code_cache[i];
+    if (entry->valid && entry->account_id == account_id) {
+      entry->valid = false;
+      if (entry->pins == 0) {
+        clear_account_code(entry);
+      }
+    }
+  }
+}
+
+void release_account_code(account_code_t* entry) {
+  if (entry == NULL) {
+    return;
+  }
+  entry->pins--;
+  if (entry->pins > 0 || entry->valid) {
+    return;
+  }
+  if (entry->cached) {
+    clear_account_code(entry);
+  } else {
+    free(entry->code);
+      free(entry);
+  }
+}
+
+/* Verify the account script and read the data hash of the contract code */
+int fetch_account_info(gw_context_t* gw_ctx, uint32_t account_id,
+                       account_code_t* entry) {
+  entry->account_id = account_id;
+  entry->is_contract = false;
+  entry->code_loaded = true;
+  entry->has_code_size = true;
+  entry->code_size = 0;
+  entry->code = NULL;
 
   int ret;
   uint8_t buffer[GW_MAX_SCRIPT_SIZE];
@@ -244,7 +418,6 @@ int load_account_code(gw_context_t* gw_ctx, uint32_t account_id,
   if (ret == GW_ERROR_ACCOUNT_NOT_EXISTS) {
     // This is an EoA or other kind of account, and not yet created
     debug_print_int("account not found", account_id);
-    *code_size = 0;
     return 0;
   }
   if (ret != 0) {
@@ -258,7 +431,6 @@ int load_account_code(gw_context_t* gw_ctx, uint32_t account_id,
     debug_print_int("[load_account_code] invalid account script", account_id);
     debug_print_int("[load_account_code] raw_args_seg.size", raw_args_seg.size);
     // This is an EoA or other kind of account
-    *code_size = 0;
     return 0;
   }
   if (memcmp(code_hash_seg.ptr, g_script_code_hash, 32) != 0
@@ -270,46 +442,255 @@ int load_account_code(gw_context_t* gw_ctx, uint32_t account_id,
   ) {
     debug_print_int("[load_account_code] creator account id not match for account", account_id);
     // This is an EoA or other kind of account
-    *code_size = 0;
     return 0;
   }
+  entry->is_contract = true;
 
   debug_print_int("[load_account_code] account_id", account_id);
   uint8_t key[32];
-  uint8_t data_hash[32];
   polyjuice_build_contract_code_key(account_id, key);
-  ret = gw_ctx->sys_load(gw_ctx, account_id, key, GW_KEY_BYTES, data_hash);
+  ret = gw_ctx->sys_load(gw_ctx, account_id, key, GW_KEY_BYTES, entry->data_hash);
   if (ret != 0) {
     debug_print_int("[load_account_code] sys_load failed", ret);
     return ret;
   }
-
-  bool is_data_hash_zero = true;
-  for (size_t i = 0; i < 32; i++) {
-    if (data_hash[i] != 0) {
-      is_data_hash_zero = false;
-      break;
-    }
-  }
-  if (is_data_hash_zero) {
+  if (_is_zero_hash(entry->data_hash)) {
     ckb_debug("[load_account_code] data hash all zero");
-    *code_size = 0;
     return 0;
   }
+  entry->code_loaded = false;
+  entry->has_code_size = false;
+  return 0;
+}
 
-  debug_print_int("[load_account_code] code_size before loading", *code_size);
-  ret = gw_ctx->sys_load_data(gw_ctx, data_hash, code_size, offset, code);
-  debug_print_int("[load_account_code] code_size after loading", *code_size);
+int fetch_account_code(gw_context_t* gw_ctx, account_code_t* entry) {
+  /* load into a MAX_DATA_SIZE buffer and shrink it in place afterwards,
+   * instead of keeping a static load buffer around for the whole process */
+  uint8_t* code = (uint8_t*)malloc(MAX_DATA_SIZE);
+  if (code == NULL) {
+    ckb_debug("[load_account_code] malloc failed");
+    return FATAL_POLYJUICE;
+  }
+  uint64_t code_size = MAX_DATA_SIZE;
+  int ret = gw_ctx->sys_load_data(gw_ctx, entry->data_hash, &code_size, 0,
+                                  code);
+  debug_print_int("[load_account_code] code_size after loading", code_size);
   if (ret != 0) {
     ckb_debug("[load_account_code] sys_load_data failed");
+    free(code);
     return ret;
   }
-  if (*code_size > MAX_DATA_SIZE) {
+  if (code_size > MAX_DATA_SIZE) {
     debug_print_int("[load_account_code] code_size can't be larger than",
                     MAX_DATA_SIZE);
+    free(code);
     return GW_FATAL_BUFFER_OVERFLOW;
   }
+  if (code_size == 0) {
+    free(code);
+    code = NULL;
+  } else {
+    /* newlib shrinks in place, keep the full buffer if it can't */
+    uint8_t* shrunk = (uint8_t*)realloc(code, code_size);
+    if (shrunk != NULL) {
+      code = shrunk;
+    }
+  }
+  entry->code = code;
+  entry->code_size = code_size;
+  entry->code_loaded = true;
+  entry->has_code_size = true;
+  return 0;
+}
+
+/**
+ * Load the script verdict and code data hash of `account_id` through the
+ * per-transaction code cache, without loading the code itself.
+ *
+ * The returned entry must be released by `release_account_code`.
+ */
+int load_account_info(gw_context_t* gw_ctx, uint32_t account_id,
+                      account_code_t** entry_ptr) {
+  account_code_t* entry = NULL;
+  for (size_t i = 0; i < CODE_CACHE_CAPACITY; i++) {
+    if (g_code_cache[i].valid && g_code_cache[i].account_id == account_id) {
+      g_code_cache[i].pins++;
+      *entry_ptr = &g_code_cache[i];
+      return 0;
+    }
+  }
+
+  /* prefer an empty slot, otherwise evict an unpinned entry in turn */
+  for (size_t i = 0; i < CODE_CACHE_CAPACITY && entry == NULL; i++) {
+    if (!g_code_cache[i].valid && g_code_cache[i].pins == 0) {
+      entry = &g_code_cache[i];
+    }
+  }
+  for (size_t i = 0; i < CODE_CACHE_CAPACITY && entry == NULL; i++) {
+    uint32_t index = (g_code_cache_cursor + i) % CODE_CACHE_CAPACITY;
+    if (g_code_cache[index].pins == 0) {
+      entry = &g_code_cache[index];
+      g_code_cache_cursor = index + 1;
+    }
+  }
+  if (entry != NULL) {
+    clear_account_code(entry);
+    entry->cached = true;
+  } else {
+    ckb_debug("[load_account_code] all cache entries are in use");
+    entry = (account_code_t*)malloc(sizeof(account_code_t));
+    if (entry == NULL) {
+      return FATAL_POLYJUICE;
+    }
+    memset(entry, 0, sizeof(account_code_t));
+  }
+
+  int ret = fetch_account_info(gw_ctx, account_id, entry);
+  if (ret != 0) {
+    if (entry->cached) {
+      clear_account_code(entry);
+    } else {
+      free(entry);
+    }
+    return ret;
+  }
+  entry->valid = entry->cached;
+  entry->pins = 1;
+  *entry_ptr = entry;
+  return 0;
+}
+
+/**
+ * Load the code of `account_id` through the per-transaction code cache.
+ *
+ * `code_size` of the returned entry is 0 for EoA, not yet created accounts and
+ * other kinds of accounts. The entry must be released by
+ * `release_account_code`.
+ */
+int load_account_code(gw_context_t* gw_ctx, uint32_t account_id,
+                      account_code_t** entry_ptr) {
+  account_code_t* entry = NULL;
+  int ret = load_account_info(gw_ctx, account_id, &entry);
+  if (ret != 0) {
+    return ret;
+  }
+  if (!entry->code_loaded) {
+    ret = fetch_account_code(gw_ctx, entry);
+    if (ret != 0) {
+      release_account_code(entry);
+      return ret;
+    }
+  }
+  *entry_ptr = entry;
+  return 0;
+}
 
+/**
+ * Load the code length of `account_id`, 0 for accounts without code.
+ *
+ * The length is stored under POLYJUICE_CONTRACT_CODE_SIZE by
+ * `store_contract_code`, so EXTCODESIZE and the contract checks need no code
+ * loading. For contracts deployed before that the code is loaded once per
+ * transaction; nothing is written back since EXTCODESIZE is reachable under
+ * STATICCALL.
+ */
+int load_account_code_size(gw_context_t* gw_ctx, uint32_t account_id,
+                           uint64_t* code_size) {
+  account_code_t* entry = NULL;
+  int ret = load_account_info(gw_ctx, account_id, &entry);
+  if (ret != 0) {
+    return ret;
+  }
+  if (entry->has_code_size) {
+    *code_size = entry->code_size;
+    release_account_code(entry);
+    return 0;
+  }
+
+  uint8_t key[GW_KEY_BYTES];
+  uint8_t value[GW_VALUE_BYTES] = {0};
+  polyjuice_build_contract_code_size_key(account_id, key);
+  ret = gw_ctx->sys_load(gw_ctx, account_id, key, GW_KEY_BYTES, value);
+  if (ret != 0) {
+    debug_print_int("[load_account_code_size] sys_load failed", ret);
+    release_account_code(entry);
+    return ret;
+  }
+  if (value[CODE_SIZE_PRESENT_OFFSET] == CODE_SIZE_PRESENT) {
+    uint32_t stored_size = 0;
+    memcpy(&stored_size, value, sizeof(uint32_t));
+    entry->code_size = stored_size;
+  } else {
+    ckb_debug("[load_account_code_size] no stored code size, load code");
+    ret = fetch_account_code(gw_ctx, entry);
+    if (ret != 0) {
+      release_account_code(entry);
+      return ret;
+    }
+  }
+  entry->has_code_size = true;
+  *code_size = entry->code_size;
+  release_account_code(entry);
+  return 0;
+}
+
+/**
+ * Load keccak256(code) of a contract into `code_hash`, all zero for accounts
+ * without code.
+ *
+ * The hash is stored under POLYJUICE_CONTRACT_CODE_HASH by
+ * `store_contract_code`, for contracts deployed before that it is computed
+ * from the code once per transaction.
+ */
+int load_account_code_hash(gw_context_t* gw_ctx, uint32_t account_id,
+                           uint8_t code_hash[32]) {
+  account_code_t* entry = NULL;
+  int ret = load_account_info(gw_ctx, account_id, &entry);
+  if (ret != 0) {
+    return ret;
+  }
+  memset(code_hash, 0, 32);
+  if (!entry->is_contract || _is_zero_hash(entry->data_hash)) {
+    release_account_code(entry);
+    return 0;
+  }
+  if (entry->has_code_hash) {
+    memcpy(code_hash, entry->code_hash, 32);
+    release_account_code(entry);
+    return 0;
+  }
+
+  uint8_t key[GW_KEY_BYTES];
+  polyjuice_build_contract_code_hash_key(account_id, key);
+  ret = gw_ctx->sys_load(gw_ctx, account_id, key, GW_KEY_BYTES,
+                         entry->code_hash);
+  if (ret != 0) {
+    debug_print_int("[load_account_code_hash] sys_load failed", ret);
+    release_account_code(entry);
+    return ret;
+  }
+  if (_is_zero_hash(entry->code_hash)) {
+    /* Contract deployed before the hash was stored: hash the code and keep
+     * it in memory only. EXTCODEHASH is reachable under STATICCALL, so this
+     * read path must not write state. */
+    ckb_debug("[load_account_code_hash] compute code hash");
+    if (!entry->code_loaded) {
+      ret = fetch_account_code(gw_ctx, entry);
+      if (ret != 0) {
+        release_account_code(entry);
+        return ret;
+      }
+    }
+    if (entry->code_size > 0) {
+      union ethash_hash256 hash_result = ethash::keccak256(entry->code,
+                                                           entry->code_size);
+      memcpy(entry->code_hash, hash_result.bytes, 32);
+    }
+  }
+  /* the all zero hash of empty code is cached too */
+  entry->has_code_hash = true;
+  memcpy(code_hash, entry->code_hash, 32);
+  release_account_code(entry);
   return 0;
 }
 
@@ -383,19 +764,305 @@ bool account_exists(struct evmc_host_context* context,
   return exists;
 }
 
+/**
+ * Per-transaction write-back cache of contract storage
+ *
+ * Every slot touched by SLOAD/SSTORE keeps its value at the beginning of the
+ * transaction (`original`) and its current value. SLOAD is served from the
+ * cache, SSTORE only updates `current`, and dirty slots are written by
+ * `flush_storage_cache` once before `gw_finalize`.
+ *
+ * The table uses open addressing with linear probing and grows when it is
+ * 3/4 full, slots are never removed within a transaction.
+ */
+#define STORAGE_CACHE_INIT_CAPACITY 64 /* must be a power of 2 */
+typedef struct {
+  bool used;
+  bool dirty;
+  /* in the EIP-2929 accessed_storage_keys set, see `access_storage` */
+  bool warm;
+  /* the last frame that journaled this slot, see `set_storage` */
+  uint32_t journal_frame;
+  uint32_t account_id;
+  uint8_t key[GW_KEY_BYTES];
+  uint8_t original[GW_VALUE_BYTES];
+  uint8_t current[GW_VALUE_BYTES];
+} storage_slot_t;
+static storage_slot_t* g_storage_slots = NULL;
+static uint32_t g_storage_slots_capacity = 0;
+static uint32_t g_storage_slots_count = 0;
+
+void init_storage_cache() {
+  free(g_storage_slots);
+  g_storage_slots = NULL;
+  g_storage_slots_capacity = 0;
+  g_storage_slots_count = 0;
+}
+
+uint32_t storage_slot_hash(uint32_t account_id,
+                           const uint8_t key[GW_KEY_BYTES]) {
+  /* FNV-1a over the account id and key words, slot keys can be small
+   * integers as well as keccak256 hashes */
+  uint32_t h = 2166136261u ^ account_id;
+  for (size_t i = 0; i < GW_KEY_BYTES; i += sizeof(uint32_t)) {
+    uint32_t word;
+    memcpy(&word, key + i, sizeof(uint32_t));
+    h = (h ^ word) * 16777619u;
+  }
+  return h ^ (h >> 16);
+}
+
+storage_slot_t* find_storage_slot(storage_slot_t* slots, uint32_t capacity,
+                                  uint32_t account_id,
+                                  const uint8_t key[GW_KEY_BYTES]) {
+  uint32_t index = storage_slot_hash(account_id, key) & (capacity - 1);
+  while (slots[index].used) {
+    if (slots[index].account_id == account_id &&
+        memcmp(slots[index].key, key, GW_KEY_BYTES) == 0) {
+      break;
+    }
+    index = (index + 1) & (capacity - 1);
+  }
+  /* either the matched slot or the empty slot to insert into */
+  return &slots[index];
+}
+
+int grow_storage_cache() {
+  uint32_t new_capacity = g_storage_slots_capacity == 0
+                        ? STORAGE_CACHE_INIT_CAPACITY
+                        : g_storage_slots_capacity * 2;
+  storage_slot_t* new_slots =
+      (storage_slot_t*)malloc(sizeof(storage_slot_t) * new_capacity);
+  if (new_slots == NULL) {
+    ckb_debug("[grow_storage_cache] malloc failed");
+    return FATAL_POLYJUICE;
+  }
+  memset(new_slots, 0, sizeof(storage_slot_t) * new_capacity);
+  for (uint32_t i = 0; i < g_storage_slots_capacity; i++) {
+    storage_slot_t* slot = &g_storage_slots[i];
+    if (slot->used) {
+      *find_storage_slot(new_slots, new_capacity, slot->account_id,
+                         slot->key) = *slot;
+    }
+  }
+  free(g_storage_slots);
+  g_storage_slots = new_slots;
+  g_storage_slots_capacity = new_capacity;
+  return 0;
+}
+
+/**
+ * Find the cached slot of (account_id, key), loading the original value from
+ * the state on the first access in this transaction.
+ *
+ * The returned pointer is valid until the next call.
+ */
+int load_storage_slot(gw_context_t* gw_ctx, uint32_t account_id,
+                      const uint8_t key[GW_KEY_BYTES],
+                      storage_slot_t** slot_ptr) {
+  if ((g_storage_slots_count + 1) * 4 > g_storage_slots_capacity * 3) {
+    int ret = grow_storage_cache();
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  storage_slot_t* slot = find_storage_slot(
+      g_storage_slots, g_storage_slots_capacity, account_id, key);
+  if (!slot->used) {
+    int ret = gw_ctx->sys_load(gw_ctx, account_id, key, GW_KEY_BYTES,
+                               slot->original);
+    if (ret != 0) {
+      memset(slot, 0, sizeof(storage_slot_t));
+      return ret;
+    }
+    slot->used = true;
+    slot->dirty = false;
+    slot->warm = false;
+    slot->journal_frame = 0;
+    slot->account_id = account_id;
+    memcpy(slot->key, key, GW_KEY_BYTES);
+    memcpy(slot->current, slot->original, GW_VALUE_BYTES);
+    g_storage_slots_count++;
+  }
+  *slot_ptr = slot;
+  return 0;
+}
+
+/* Write all modified slots back to the state, must run before gw_finalize */
+int flush_storage_cache(gw_context_t* gw_ctx) {
+  for (uint32_t i = 0; i < g_storage_slots_capacity; i++) {
+    storage_slot_t* slot = &g_storage_slots[i];
+    if (!slot->used || !slot->dirty) {
+      continue;
+    }
+    if (memcmp(slot->current, slot->original, GW_VALUE_BYTES) != 0) {
+      int ret = gw_ctx->sys_store(gw_ctx, slot->account_id, slot->key,
+                                  GW_KEY_BYTES, slot->current);
+      if (ret != 0) {
+        debug_print_int("[flush_storage_cache] sys_store failed", ret);
+        return ret;
+      }
+    }
+    slot->dirty = false;
+  }
+  return 0;
+}
+
+/**
+ * Journal of the cached state changes made by the running frames
+ *
+ * `set_storage` records the previous value of a slot before changing it,
+ * `handle_message` takes a mark when a frame starts and reverts the journal
+ * back to it when the frame fails, so the storage writes of a reverted
+ * sub-call are undone while its caller goes on.
+ *
+ * A slot is journaled once per frame, by its first change in the frame, so
+ * the journal does not grow with every SSTORE of a loop.
+ *
+ * The EIP-2929 accessed addresses and storage keys warmed by a frame are
+ * journaled too, they turn cold again when the frame fails.
+ */
+#define JOURNAL_INIT_CAPACITY 64
+#define JOURNAL_STORAGE 0
+#define JOURNAL_WARM_SLOT 1
+#define JOURNAL_WARM_ADDRESS 2
+typedef struct {
+  uint8_t kind;
+  /* the slot's previous `dirty` flag */
+  bool dirty;
+  uint32_t account_id;
+  /* the slot key, or the address of JOURNAL_WARM_ADDRESS */
+  uint8_t key[GW_KEY_BYTES];
+  /* the slot's previous `current` value */
+  uint8_t value[GW_VALUE_BYTES];
+} journal_entry_t;
+static journal_entry_t* g_journal = NULL;
+static size_t g_journal_size = 0;
+static size_t g_journal_capacity = 0;
+/* id of the running frame, 0 is never used */
+static uint32_t g_journal_frame = 0;
+static uint32_t g_journal_frames = 0;
+
+void init_journal() {
+  free(g_journal);
+  g_journal = NULL;
+  g_journal_size = 0;
+  g_journal_capacity = 0;
+  g_journal_frame = 0;
+  g_journal_frames = 0;
+}
+
+size_t journal_mark() { return g_journal_size; }
+
+/* Give the new frame an id, returns the id of its parent */
+uint32_t journal_enter_frame() {
+  uint32_t parent_frame = g_journal_frame;
+  g_journal_frame = ++g_journal_frames;
+  return parent_frame;
+}
+
+void journal_leave_frame(uint32_t parent_frame) {
+  g_journal_frame = parent_frame;
+}
+
+/* Append an entry of `kind`, returns NULL when out of memory */
+journal_entry_t* journal_push(uint8_t kind) {
+  if (g_journal_size == g_journal_capacity) {
+    size_t capacity = g_journal_capacity == 0 ? JOURNAL_INIT_CAPACITY
+                                              : g_journal_capacity * 2;
+    journal_entry_t* journal = (journal_entry_t*)realloc(
+        g_journal, sizeof(journal_entry_t) * capacity);
+    if (journal == NULL) {
+      ckb_debug("[journal_push] realloc failed");
+      return NULL;
+    }
+    g_journal = journal;
+    g_journal_capacity = capacity;
+  }
+  journal_entry_t* entry = &g_journal[g_journal_size++];
+  entry->kind = kind;
+  return entry;
+}
+
+void unmark_address_accessed(const uint8_t address[ETH_ADDRESS_LEN]);
+
+/* Undo the changes recorded after `mark`, newest first */
+void journal_revert(size_t mark) {
+  while (g_journal_size > mark) {
+    journal_entry_t* entry = &g_journal[--g_journal_size];
+    if (entry->kind == JOURNAL_WARM_ADDRESS) {
+      unmark_address_accessed(entry->key);
+      continue;
+    }
+    /* slots are never removed, so the journaled one is still there */
+    storage_slot_t* slot =
+        find_storage_slot(g_storage_slots, g_storage_slots_capacity,
+                          entry->account_id, entry->key);
+    if (entry->kind == JOURNAL_STORAGE) {
+      memcpy(slot->current, entry->value, GW_VALUE_BYTES);
+      slot->dirty = entry->dirty;
+    } else {
+      slot->warm = false;
+    }
+  }
+}
+
+/**
+ * Writes that bypass the caches (balances, nonces, new accounts, contract
+ * code...) go straight to the Godwoken state and can not be journaled.
+ * `run_polyjuice` routes the writing syscalls through the `counted_*`
+ * wrappers, a failed frame that did any of them still fails the whole
+ * transaction.
+ */
+static uint32_t g_state_writes = 0;
+static decltype(gw_context_t::sys_store) g_sys_store = NULL;
+static decltype(gw_context_t::sys_create) g_sys_create = NULL;
+static decltype(gw_context_t::_internal_store_raw) g_internal_store_raw = NULL;
+
+int counted_sys_store(gw_context_t* ctx, uint32_t account_id,
+                      const uint8_t* key, const uint64_t key_len,
+                      const uint8_t* value) {
+  g_state_writes++;
+  return g_sys_store(ctx, account_id, key, key_len, value);
+}
+
+int counted_sys_create(gw_context_t* ctx, uint8_t* script,
+                       uint64_t script_len, uint32_t* account_id) {
+  g_state_writes++;
+  return g_sys_create(ctx, script, script_len, account_id);
+}
+
+int counted_internal_store_raw(gw_context_t* ctx, const uint8_t* key,
+                               const uint8_t* value) {
+  g_state_writes++;
+  return g_internal_store_raw(ctx, key, value);
+}
+
+void count_state_writes(gw_context_t* ctx) {
+  g_state_writes = 0;
+  g_sys_store = ctx->sys_store;
+  ctx->sys_store = counted_sys_store;
+  g_sys_create = ctx->sys_create;
+  ctx->sys_create = counted_sys_create;
+  g_internal_store_raw = ctx->_internal_store_raw;
+  ctx->_internal_store_raw = counted_internal_store_raw;
+}
+
 evmc_bytes32 get_storage(struct evmc_host_context* context,
                          const evmc_address* address, const evmc_bytes32* key) {
   ckb_debug("BEGIN get_storage");
   evmc_bytes32 value{0};
-  int ret = context->gw_ctx->sys_load(context->gw_ctx, context->to_id,
-                                      key->bytes, GW_KEY_BYTES,
-                                      (uint8_t *)value.bytes);
+  storage_slot_t* slot = NULL;
+  int ret = load_storage_slot(context->gw_ctx, context->to_id, key->bytes,
+                              &slot);
   if (ret != 0) {
     debug_print_int("get_storage, sys_load failed", ret);
     if (is_fatal_error(ret)) {
       context->error_code = ret;
     }
+    return value;
   }
+  memcpy(value.bytes, slot->current, GW_VALUE_BYTES);
   ckb_debug("END get_storage");
   return value;
 }
@@ -405,21 +1072,255 @@ enum evmc_storage_status set_storage(struct evmc_host_context* context,
                                      const evmc_bytes32* key,
                                      const evmc_bytes32* value) {
   ckb_debug("BEGIN set_storage");
-  evmc_storage_status status = EVMC_STORAGE_ADDED;
-  int ret = context->gw_ctx->sys_store(context->gw_ctx, context->to_id,
-                                       key->bytes, GW_KEY_BYTES, value->bytes);
+  storage_slot_t* slot = NULL;
+  int ret = load_storage_slot(context->gw_ctx, context->to_id, key->bytes,
+                              &slot);
   if (ret != 0) {
-    debug_print_int("sys_store failed", ret);
+    debug_print_int("set_storage, sys_load failed", ret);
     if (is_fatal_error(ret)) {
       context->error_code = ret;
     }
+    return EVMC_STORAGE_UNCHANGED;
+  }
+
+  /* EIP-2200 storage status */
+  evmc_storage_status status;
+  if (memcmp(slot->current, value->bytes, GW_VALUE_BYTES) == 0) {
     status = EVMC_STORAGE_UNCHANGED;
+  } else if (memcmp(slot->current, slot->original, GW_VALUE_BYTES) != 0) {
+    status = EVMC_STORAGE_MODIFIED_AGAIN;
+  } else if (_is_zero_hash(slot->original)) {
+    status = EVMC_STORAGE_ADDED;
+  } else if (_is_zero_hash((uint8_t*)value->bytes)) {
+    status = EVMC_STORAGE_DELETED;
+  } else {
+    status = EVMC_STORAGE_MODIFIED;
+  }
+  if (status != EVMC_STORAGE_UNCHANGED) {
+    if (slot->journal_frame != g_journal_frame) {
+      journal_entry_t* entry = journal_push(JOURNAL_STORAGE);
+      if (entry == NULL) {
+        context->error_code = FATAL_POLYJUICE;
+        return EVMC_STORAGE_UNCHANGED;
+      }
+      entry->dirty = slot->dirty;
+      entry->account_id = slot->account_id;
+      memcpy(entry->key, slot->key, GW_KEY_BYTES);
+      memcpy(entry->value, slot->current, GW_VALUE_BYTES);
+      slot->journal_frame = g_journal_frame;
+    }
+    memcpy(slot->current, value->bytes, GW_VALUE_BYTES);
+    slot->dirty = true;
   }
-  /* TODO: more rich evmc_storage_status */
-  ckb_debug("END set_storage");
+  debug_print_int("END set_storage", status);
   return status;
 }
 
+/**
+ * EIP-2929 accessed_addresses set of the transaction
+ *
+ * A growable open-addressing set like the storage cache. The set of accessed
+ * storage keys is the `warm` flag of the storage cache slots, so a warm slot
+ * is always served from memory.
+ *
+ * Entries are never removed, an address warmed by a failed frame only has its
+ * `warm` flag cleared by `journal_revert`.
+ */
+#define ACCESSED_ADDRESSES_INIT_CAPACITY 32 /* must be a power of 2 */
+typedef struct {
+  bool used;
+  bool warm;
+  uint8_t address[ETH_ADDRESS_LEN];
+} accessed_address_t;
+static accessed_address_t* g_accessed_addresses = NULL;
+static uint32_t g_accessed_addresses_capacity = 0;
+static uint32_t g_accessed_addresses_count = 0;
+
+void init_accessed_addresses() {
+  free(g_accessed_addresses);
+  g_accessed_addresses = NULL;
+  g_accessed_addresses_capacity = 0;
+  g_accessed_addresses_count = 0;
+}
+
+accessed_address_t* find_accessed_address(accessed_address_t* set,
+                                          uint32_t capacity,
+                                          const uint8_t address[ETH_ADDRESS_LEN]) {
+  /* pre-compiled contract addresses only differ in the last byte */
+  uint32_t h;
+  memcpy(&h, address + ETH_ADDRESS_LEN - sizeof(uint32_t), sizeof(uint32_t));
+  h *= 2654435761u;
+  uint32_t index = (h ^ (h >> 16)) & (capacity - 1);
+  while (set[index].used &&
+         memcmp(set[index].address, address, ETH_ADDRESS_LEN) != 0) {
+    index = (index + 1) & (capacity - 1);
+  }
+  return &set[index];
+}
+
+/**
+ * Add `address` to the accessed addresses
+ *
+ * @param warm set to whether the address was accessed before, may be NULL
+ */
+int mark_address_accessed(const uint8_t address[ETH_ADDRESS_LEN], bool* warm) {
+  if ((g_accessed_addresses_count + 1) * 4 > g_accessed_addresses_capacity * 3) {
+    uint32_t new_capacity = g_accessed_addresses_capacity == 0
+                          ? ACCESSED_ADDRESSES_INIT_CAPACITY
+                          : g_accessed_addresses_capacity * 2;
+    accessed_address_t* new_set = (accessed_address_t*)malloc(
+        sizeof(accessed_address_t) * new_capacity);
+    if (new_set == NULL) {
+      ckb_debug("[mark_address_accessed] malloc failed");
+      return FATAL_POLYJUICE;
+    }
+    memset(new_set, 0, sizeof(accessed_address_t) * new_capacity);
+    for (uint32_t i = 0; i < g_accessed_addresses_capacity; i++) {
+      if (g_accessed_addresses[i].used) {
+        *find_accessed_address(new_set, new_capacity,
+                               g_accessed_addresses[i].address) =
+            g_accessed_addresses[i];
+      }
+    }
+    free(g_accessed_addresses);
+    g_accessed_addresses = new_set;
+    g_accessed_addresses_capacity = new_capacity;
+  }
+  accessed_address_t* entry = find_accessed_address(
+      g_accessed_addresses, g_accessed_addresses_capacity, address);
+  if (warm != NULL) {
+    *warm = entry->warm;
+  }
+  if (!entry->used) {
+    entry->used = true;
+    memcpy(entry->address, address, ETH_ADDRESS_LEN);
+    g_accessed_addresses_count++;
+  }
+  if (!entry->warm) {
+    entry->warm = true;
+    /* nothing is reverted outside of the frames */
+    if (g_journal_frame != 0) {
+      journal_entry_t* journal_entry = journal_push(JOURNAL_WARM_ADDRESS);
+      if (journal_entry == NULL) {
+        return FATAL_POLYJUICE;
+      }
+      memcpy(journal_entry->key, address, ETH_ADDRESS_LEN);
+    }
+  }
+  return 0;
+}
+
+void unmark_address_accessed(const uint8_t address[ETH_ADDRESS_LEN]) {
+  find_accessed_address(g_accessed_addresses, g_accessed_addresses_capacity,
+                        address)->warm = false;
+}
+
+/* Pre-warm tx.origin, the destination and all pre-compiled contracts */
+int init_access_set(const evmc_message* msg) {
+  init_accessed_addresses();
+  int ret = mark_address_accessed(msg->sender.bytes, NULL);
+  if (ret != 0) {
+    return ret;
+  }
+  if (!is_create(msg->kind)) {
+    ret = mark_address_accessed(msg->destination.bytes, NULL);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  for (int n = 1; n <= 0xff; n++) {
+    if (g_precompiled_contracts.entries[n].contract != NULL) {
+      evmc_address addr{0};
+      addr.bytes[19] = (uint8_t)n;
+      ret = mark_address_accessed(addr.bytes, NULL);
+      if (ret != 0) {
+        return ret;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Warm up the access list of the transaction, and prefetch its storage keys
+ * into the storage cache before execution starts.
+ */
+int apply_access_list(gw_context_t* ctx) {
+  if (g_access_list == NULL) {
+    return 0;
+  }
+  size_t offset = 4;
+  for (uint32_t i = 0; i < g_access_list_addresses; i++) {
+    const uint8_t* address = g_access_list + offset;
+    uint32_t key_count;
+    memcpy(&key_count, address + ETH_ADDRESS_LEN, sizeof(uint32_t));
+    offset += ETH_ADDRESS_LEN + 4;
+    int ret = mark_address_accessed(address, NULL);
+    if (ret != 0) {
+      return ret;
+    }
+
+    uint32_t account_id = 0;
+    ret = load_account_id_by_eth_address(ctx, address, &account_id);
+    if (ret == GW_ERROR_NOT_FOUND) {
+      /* no storage to prefetch, and no contract to warm it for */
+      offset += (size_t)key_count * 32;
+      continue;
+    }
+    if (ret != 0) {
+      return ret;
+    }
+    for (uint32_t j = 0; j < key_count; j++) {
+      storage_slot_t* slot = NULL;
+      ret = load_storage_slot(ctx, account_id, g_access_list + offset, &slot);
+      if (ret != 0) {
+        return ret;
+      }
+      slot->warm = true;
+      offset += 32;
+    }
+  }
+  return 0;
+}
+
+enum evmc_access_status access_account(struct evmc_host_context* context,
+                                       const evmc_address* address) {
+  bool warm = false;
+  int ret = mark_address_accessed(address->bytes, &warm);
+  if (ret != 0) {
+    context->error_code = ret;
+  }
+  return warm ? EVMC_ACCESS_WARM : EVMC_ACCESS_COLD;
+}
+
+enum evmc_access_status access_storage(struct evmc_host_context* context,
+                                       const evmc_address* address,
+                                       const evmc_bytes32* key) {
+  /* load the slot now, SLOAD/SSTORE of it always follows */
+  storage_slot_t* slot = NULL;
+  int ret = load_storage_slot(context->gw_ctx, context->to_id, key->bytes,
+                              &slot);
+  if (ret != 0) {
+    debug_print_int("access_storage, sys_load failed", ret);
+    if (is_fatal_error(ret)) {
+      context->error_code = ret;
+    }
+    return EVMC_ACCESS_COLD;
+  }
+  if (slot->warm) {
+    return EVMC_ACCESS_WARM;
+  }
+  journal_entry_t* entry = journal_push(JOURNAL_WARM_SLOT);
+  if (entry == NULL) {
+    context->error_code = FATAL_POLYJUICE;
+    return EVMC_ACCESS_COLD;
+  }
+  entry->account_id = slot->account_id;
+  memcpy(entry->key, slot->key, GW_KEY_BYTES);
+  slot->warm = true;
+  return EVMC_ACCESS_COLD;
+}
+
 size_t get_code_size(struct evmc_host_context* context,
                      const evmc_address* address) {
   ckb_debug("BEGIN get_code_size");
@@ -435,11 +1336,10 @@ size_t get_code_size(struct evmc_host_context* context,
     return 0;
   }
 
-  uint8_t code[MAX_DATA_SIZE];
-  uint64_t code_size = MAX_DATA_SIZE;
-  ret = load_account_code(context->gw_ctx, account_id, &code_size, 0, code);
+  uint64_t code_size = 0;
+  ret = load_account_code_size(context->gw_ctx, account_id, &code_size);
   if (ret != 0) {
-    debug_print_int("[get_code_size] load_account_code failed", ret);
+    debug_print_int("[get_code_size] load_account_code_size failed", ret);
     context->error_code = ret;
     return 0;
   }
@@ -465,19 +1365,12 @@ evmc_bytes32 get_code_hash(struct evmc_host_context* context,
     return hash;
   }
 
-  uint8_t code[MAX_DATA_SIZE];
-  uint64_t code_size = MAX_DATA_SIZE;
-  ret = load_account_code(context->gw_ctx, account_id, &code_size, 0, code);
+  ret = load_account_code_hash(context->gw_ctx, account_id, hash.bytes);
   if (ret != 0) {
-    debug_print_int("[get_code_hash] load_account_code failed", ret);
+    debug_print_int("[get_code_hash] load_account_code_hash failed", ret);
     context->error_code = ret;
     return hash;
   }
-
-  if (code_size > 0) {
-    union ethash_hash256 hash_result = ethash::keccak256(code, code_size);
-    memcpy(hash.bytes, hash_result.bytes, 32);
-  }
   ckb_debug("END get_code_hash");
   return hash;
 }
@@ -517,17 +1410,26 @@ size_t copy_code(struct evmc_host_context* context, const evmc_address* address,
     return 0;
   }
 
-  uint64_t code_size = buffer_size;
-  ret = load_account_code(context->gw_ctx, account_id, &code_size,
-                          code_offset, buffer_data);
+  account_code_t* code = NULL;
+  ret = load_account_code(context->gw_ctx, account_id, &code);
   if (ret != 0) {
     debug_print_int("[copy_code] load_account_code failed", ret);
     context->error_code = ret;
     return 0;
   }
 
+  size_t copy_size = 0;
+  if (code_offset < code->code_size) {
+    copy_size = code->code_size - code_offset;
+    if (copy_size > buffer_size) {
+      copy_size = buffer_size;
+    }
+    memcpy(buffer_data, code->code + code_offset, copy_size);
+  }
+  release_account_code(code);
+
   ckb_debug("END copy_code");
-  return code_size >= buffer_size ? buffer_size : code_size;
+  return copy_size;
 }
 
 evmc_uint256be get_balance(struct evmc_host_context* context,
@@ -600,6 +1502,102 @@ void selfdestruct(struct evmc_host_context* context,
   return;
 }
 
+#ifdef POLYJUICE_PRECOMPILE_CACHE
+/**
+ * Per-transaction memo of pure pre-compiled contract results (opt-in)
+ *
+ * Keyed by (last address byte, input size, blake2b hash of the input), so a
+ * proof or signature verified several times in one transaction, e.g. by a
+ * multicall batch, only runs once. A hit borrows the cached output.
+ * The gas function still runs and the same gas is charged on a hit. Only
+ * successful results up to PRECOMPILE_CACHE_MAX_OUTPUT_SIZE bytes are kept,
+ * the oldest entry is replaced when the cache is full. Enabled by building
+ * with -DPOLYJUICE_PRECOMPILE_CACHE.
+ */
+#define PRECOMPILE_CACHE_CAPACITY 16
+#define PRECOMPILE_CACHE_MAX_OUTPUT_SIZE 1024
+typedef struct {
+  bool valid;
+  uint8_t address;
+  size_t input_size;
+  uint8_t input_hash[32];
+  uint8_t* output;
+  size_t output_size;
+} precompile_cache_entry_t;
+static precompile_cache_entry_t g_precompile_cache[PRECOMPILE_CACHE_CAPACITY];
+static size_t g_precompile_cache_next = 0;
+#ifdef POLYJUICE_DEBUG_LOG
+static uint32_t g_precompile_cache_hits = 0;
+static uint32_t g_precompile_cache_misses = 0;
+#endif
+
+void init_precompile_cache() {
+  for (size_t i = 0; i < PRECOMPILE_CACHE_CAPACITY; i++) {
+    free(g_precompile_cache[i].output);
+  }
+  memset(g_precompile_cache, 0, sizeof(g_precompile_cache));
+  g_precompile_cache_next = 0;
+#ifdef POLYJUICE_DEBUG_LOG
+  g_precompile_cache_hits = 0;
+  g_precompile_cache_misses = 0;
+#endif
+}
+
+/**
+ * Hand out a cached output as a borrowed view, entries are only replaced by
+ * a later store_precompile_cache, after the caller has consumed the result
+ *
+ * @return true on a hit, false on a miss
+ */
+bool load_precompile_cache(uint8_t address, const uint8_t input_hash[32],
+                           size_t input_size, precompiled_output_t* output) {
+  for (size_t i = 0; i < PRECOMPILE_CACHE_CAPACITY; i++) {
+    precompile_cache_entry_t* entry = &g_precompile_cache[i];
+    if (!entry->valid || entry->address != address ||
+        entry->input_size != input_size ||
+        memcmp(entry->input_hash, input_hash, 32) != 0) {
+      continue;
+    }
+#ifdef POLYJUICE_DEBUG_LOG
+    g_precompile_cache_hits++;
+    debug_print_int("[precompile cache] hits", g_precompile_cache_hits);
+#endif
+    borrow_precompiled_output(output, entry->output, entry->output_size);
+    return true;
+  }
+#ifdef POLYJUICE_DEBUG_LOG
+  g_precompile_cache_misses++;
+#endif
+  return false;
+}
+
+void store_precompile_cache(uint8_t address, const uint8_t input_hash[32],
+                            size_t input_size, const uint8_t* output,
+                            size_t output_size) {
+  if (output_size > PRECOMPILE_CACHE_MAX_OUTPUT_SIZE) {
+    return;
+  }
+  uint8_t* copy = NULL;
+  if (output_size > 0) {
+    copy = (uint8_t*)malloc(output_size);
+    if (copy == NULL) {
+      return;
+    }
+    memcpy(copy, output, output_size);
+  }
+  precompile_cache_entry_t* entry = &g_precompile_cache[g_precompile_cache_next];
+  g_precompile_cache_next =
+      (g_precompile_cache_next + 1) % PRECOMPILE_CACHE_CAPACITY;
+  free(entry->output);
+  entry->valid = true;
+  entry->address = address;
+  entry->input_size = input_size;
+  memcpy(entry->input_hash, input_hash, 32);
+  entry->output = copy;
+  entry->output_size = output_size;
+}
+#endif /* POLYJUICE_PRECOMPILE_CACHE */
+
 struct evmc_result call(struct evmc_host_context* context,
                         const struct evmc_message* msg) {
   ckb_debug("BEGIN call");
@@ -614,13 +1612,16 @@ struct evmc_result call(struct evmc_host_context* context,
   res.release = release_result;
   gw_context_t* gw_ctx = context->gw_ctx;
 
-  /* TODO: Revert in try block has not been implemented. Will fix later.*/
 
-  precompiled_contract_gas_fn contract_gas;
-  precompiled_contract_fn contract;
-  if (match_precompiled_address(&msg->destination, &contract_gas, &contract)) {
+  const precompiled_contract_t* precompiled =
+      lookup_precompiled_contract(&msg->destination);
+  if (precompiled != NULL) {
     uint64_t gas_cost = 0;
-    ret = contract_gas(msg->input_data, msg->input_size, &gas_cost);
+    /* parsed once by the gas function and reused by the contract */
+    precompiled_input_t parsed_input;
+    parsed_input.ready = false;
+    ret = precompiled->contract_gas(msg->input_data, msg->input_size,
+                                    &gas_cost, &parsed_input);
     if (is_fatal_error(ret)) {
       context->error_code = ret;
     }
@@ -635,18 +1636,62 @@ struct evmc_result call(struct evmc_host_context* context,
       return res;
     }
     res.gas_left = msg->gas - (int64_t)gas_cost;
-    ret = contract(gw_ctx,
-                   context->code_data, context->code_size,
-                   context->kind,
-                   msg->flags == EVMC_STATIC,
-                   msg->input_data, msg->input_size,
-                   (uint8_t**)&res.output_data, &res.output_size);
+    if (msg->flags == EVMC_STATIC && !precompiled->static_safe) {
+      ckb_debug("call pre-compiled contract that writes state in static mode");
+      res.status_code = EVMC_STATIC_MODE_VIOLATION;
+      return res;
+    }
+    /* outputs go to the tx arena, evmone consumes and releases them before
+     * the next host call, so release_result pops them right away */
+    precompiled_output_t output;
+    init_precompiled_output(&output);
+    bool cache_hit = false;
+#ifdef POLYJUICE_PRECOMPILE_CACHE
+    uint8_t input_hash[32];
+    if (precompiled->pure) {
+      blake2b_hash(input_hash, (uint8_t*)msg->input_data, msg->input_size);
+      cache_hit = load_precompile_cache(msg->destination.bytes[19], input_hash,
+                                        msg->input_size, &output);
+    }
+#endif
+    uint32_t state_writes = g_state_writes;
+    if (cache_hit) {
+      ret = 0;
+    } else {
+      ret = precompiled->contract(gw_ctx,
+                                  context->code_data, context->code_size,
+                                  context->kind,
+                                  msg->flags == EVMC_STATIC,
+                                  msg->input_data, msg->input_size,
+                                  &output, &parsed_input);
+      if (ret == 0 && precompiled->max_output_size != 0 &&
+          output.size > precompiled->max_output_size) {
+        debug_print_int("pre-compiled contract output too large", output.size);
+        ret = FATAL_PRECOMPILED_CONTRACTS;
+      }
+#ifdef POLYJUICE_PRECOMPILE_CACHE
+      if (ret == 0 && precompiled->pure) {
+        store_precompile_cache(msg->destination.bytes[19], input_hash,
+                               msg->input_size, output.data, output.size);
+      }
+#endif
+    }
+    res.output_data = output.data;
+    res.output_size = output.size;
+    /* only heap outputs are freed by the caller */
+    if (output.ownership != PRECOMPILED_OUTPUT_HEAP) {
+      res.release = NULL;
+    }
     if (is_fatal_error(ret)) {
       context->error_code = ret;
     }
     if (ret != 0) {
       debug_print_int("call pre-compiled contract failed", ret);
       res.status_code = EVMC_INTERNAL_ERROR;
+      /* like a failed frame, see handle_message */
+      if (g_state_writes != state_writes) {
+        g_error_code = ret;
+      }
     } else {
       res.status_code = EVMC_SUCCESS;
     }
@@ -667,9 +1712,6 @@ struct evmc_result call(struct evmc_host_context* context,
     }
   }
 
-  if (is_evmc_error(res.status_code)) {
-    g_error_code = res.status_code;
-  }
   debug_print_int("call.res.status_code", res.status_code);
   ckb_debug("END call");
 
@@ -690,49 +1732,199 @@ evmc_bytes32 get_block_hash(struct evmc_host_context* context, int64_t number) {
   return block_hash;
 }
 
-void emit_log(struct evmc_host_context* context, const evmc_address* address,
-              const uint8_t* data, size_t data_size,
-              const evmc_bytes32 topics[], size_t topics_count) {
-  ckb_debug("BEGIN emit_log");
-  /*
+/*
+  Serialized GW_LOG_POLYJUICE_USER log:
+
     output[ 0..20]                     = callee_contract.address
     output[20..24]                     = data_size_u32
     output[24..24+data_size]           = data
     ouptut[24+data_size..28+data_size] = topics_count_u32
     ouptut[28+data_size..]             = topics
-   */
-  size_t output_size = 20 + (4 + data_size) + (4 + topics_count * 32);
-  uint8_t* output = (uint8_t*)malloc(output_size);
-  if (output == NULL) {
-    context->error_code = -1;
-    return;
-  }
+ */
+size_t polyjuice_user_log_size(size_t data_size, size_t topics_count) {
+  return 20 + (4 + data_size) + (4 + topics_count * 32);
+}
+
+static_assert(sizeof(evmc_bytes32) == 32, "topics are copied as one block");
+
+/* write the log straight into `output`, which holds polyjuice_user_log_size()
+ * bytes, the topics are contiguous in evmc_bytes32[] and copied at once */
+void serialize_polyjuice_user_log(uint8_t* output, const evmc_address* address,
+                                  const uint8_t* data, size_t data_size,
+                                  const evmc_bytes32 topics[],
+                                  size_t topics_count) {
   uint32_t data_size_u32 = (uint32_t)(data_size);
   uint32_t topics_count_u32 = (uint32_t)(topics_count);
-
-  uint8_t* output_current = output;
-  memcpy(output_current, address->bytes, 20);
-  output_current += 20;
-  memcpy(output_current, (uint8_t*)(&data_size_u32), 4);
-  output_current += 4;
+  memcpy(output, address->bytes, 20);
+  output += 20;
+  memcpy(output, (uint8_t*)(&data_size_u32), 4);
+  output += 4;
   if (data_size > 0) {
-    memcpy(output_current, data, data_size);
-    output_current += data_size;
+    memcpy(output, data, data_size);
+    output += data_size;
+  }
+  memcpy(output, (uint8_t*)(&topics_count_u32), 4);
+  output += 4;
+  if (topics_count > 0) {
+    memcpy(output, topics, topics_count * sizeof(evmc_bytes32));
+  }
+}
+
+/*
+  Logs emitted while a frame runs (user logs, and the sUDT transfer logs of
+  its value transfers) are buffered instead of going to sys_log one by one,
+  each entry is
+
+    entry[0..4]   = account_id_u32
+    entry[4..8]   = log_size_u32
+    entry[8]      = service_flag
+    entry[9..12]  = reserved
+    entry[12..]   = log data
+
+  handle_message() takes a mark on entry and truncates back to it when the
+  frame does not succeed, so the logs of a reverted call tree never reach
+  Godwoken, and logs keep their emission order whatever their kind. Logs
+  emitted outside of the frames (the EVM result log, the fee) flush the
+  buffer first, it is never flushed while a frame is open.
+
+  Godwoken has no batched log syscall, so the flush still makes one sys_log
+  per entry. The buffer holds at most LOG_BUFFER_MAX_SIZE bytes, a log that
+  does not fit fails its frame with ERROR_LOG_BUFFER_FULL.
+ */
+#define LOG_ENTRY_HEADER_SIZE 12
+#define LOG_BUFFER_MIN_CAPACITY 4096
+#define LOG_BUFFER_MAX_SIZE (256 * 1024)
+
+static uint8_t* g_log_buffer = NULL;
+static size_t g_log_buffer_size = 0;
+static size_t g_log_buffer_capacity = 0;
+/* bytes already handed to Godwoken */
+static decltype(gw_context_t::sys_log) g_sys_log = NULL;
+
+void init_log_buffer() {
+  free(g_log_buffer);
+  g_log_buffer = NULL;
+  g_log_buffer_size = 0;
+  g_log_buffer_capacity = 0;
+}
+
+size_t log_buffer_mark() { return g_log_buffer_size; }
+
+/* drop every log buffered after `mark` */
+void log_buffer_truncate(size_t mark) {
+  if (mark < g_log_buffer_size) {
+    g_log_buffer_size = mark;
+  }
+}
+
+/* hand the buffered logs to Godwoken in emission order */
+int flush_logs(gw_context_t* ctx) {
+  size_t offset = 0;
+  while (offset < g_log_buffer_size) {
+    uint32_t account_id;
+    uint32_t log_size;
+    const uint8_t* entry = g_log_buffer + offset;
+    memcpy(&account_id, entry, 4);
+    memcpy(&log_size, entry + 4, 4);
+    int ret = g_sys_log(ctx, account_id, entry[8], log_size,
+                        entry + LOG_ENTRY_HEADER_SIZE);
+    if (ret != 0) {
+      debug_print_int("sys_log failed", ret);
+      return ret;
+    }
+    offset += LOG_ENTRY_HEADER_SIZE + log_size;
   }
-  memcpy(output_current, (uint8_t*)(&topics_count_u32), 4);
-  output_current += 4;
+  g_log_buffer_size = 0;
+  return 0;
+}
+
+/**
+ * Append an entry header and reserve the space for a log of `log_size` bytes
+ *
+ * @param entry the reserved space
+ * @return ERROR_LOG_BUFFER_FULL if the log does not fit in LOG_BUFFER_MAX_SIZE
+ */
+int log_buffer_push(uint32_t account_id, uint8_t service_flag,
+                    size_t log_size, uint8_t** entry) {
+  if (log_size > LOG_BUFFER_MAX_SIZE - LOG_ENTRY_HEADER_SIZE -
+                     g_log_buffer_size) {
+    debug_print_int("[log_buffer_push] log buffer full, log size", log_size);
+    return ERROR_LOG_BUFFER_FULL;
+  }
+  size_t entry_size = LOG_ENTRY_HEADER_SIZE + log_size;
+  if (entry_size > g_log_buffer_capacity - g_log_buffer_size) {
+    size_t capacity = g_log_buffer_capacity == 0 ? LOG_BUFFER_MIN_CAPACITY
+                                                 : g_log_buffer_capacity;
+    while (capacity - g_log_buffer_size < entry_size) {
+      capacity *= 2;
+    }
+    uint8_t* buffer = (uint8_t*)realloc(g_log_buffer, capacity);
+    if (buffer == NULL) {
+      ckb_debug("[log_buffer_push] realloc failed");
+      return FATAL_POLYJUICE;
+    }
+    g_log_buffer = buffer;
+    g_log_buffer_capacity = capacity;
+  }
+  uint8_t* header = g_log_buffer + g_log_buffer_size;
+  uint32_t log_size_u32 = (uint32_t)log_size;
+  memcpy(header, (uint8_t*)(&account_id), 4);
+  memcpy(header + 4, (uint8_t*)(&log_size_u32), 4);
+  memset(header + 8, 0, 4);
+  header[8] = service_flag;
+  g_log_buffer_size += entry_size;
+  *entry = header + LOG_ENTRY_HEADER_SIZE;
+  return 0;
+}
+
+/* sys_log of the context, see `buffer_logs` */
+int buffered_sys_log(gw_context_t* ctx, uint32_t account_id,
+                     uint8_t service_flag, uint64_t data_length,
+                     const uint8_t* data) {
+  if (g_journal_frame == 0) {
+    int ret = flush_logs(ctx);
+    if (ret != 0) {
+      return ret;
+    }
+    return g_sys_log(ctx, account_id, service_flag, data_length, data);
+  }
+  uint8_t* entry = NULL;
+  int ret = log_buffer_push(account_id, service_flag, data_length, &entry);
+  if (ret != 0) {
+    ckb_debug("buffer log failed");
+    return ret;
+  }
+  memcpy(entry, data, data_length);
+  return 0;
+}
+
+/* route the logs of sUDT transfers through the log buffer */
+void buffer_logs(gw_context_t* ctx) {
+  g_sys_log = ctx->sys_log;
+  ctx->sys_log = buffered_sys_log;
+}
+
+void emit_log(struct evmc_host_context* context, const evmc_address* address,
+              const uint8_t* data, size_t data_size,
+              const evmc_bytes32 topics[], size_t topics_count) {
+  ckb_debug("BEGIN emit_log");
+#ifdef POLYJUICE_DEBUG_LOG
   for (size_t i = 0; i < topics_count; i++) {
     debug_print_data("log.topic", topics[i].bytes, 32);
-    memcpy(output_current, topics[i].bytes, 32);
-    output_current += 32;
   }
-  int ret = context->gw_ctx->sys_log(context->gw_ctx, context->to_id,
-                                     GW_LOG_POLYJUICE_USER, (uint32_t)output_size, output);
+#endif
+  /* serialized straight into the buffer, flushed by run_polyjuice() */
+  size_t output_size = polyjuice_user_log_size(data_size, topics_count);
+  uint8_t* output = NULL;
+  int ret = log_buffer_push(context->to_id, GW_LOG_POLYJUICE_USER, output_size,
+                            &output);
   if (ret != 0) {
-    ckb_debug("sys_log failed");
+    ckb_debug("buffer user log failed");
     context->error_code = ret;
+    return;
   }
-  free(output);
+  serialize_polyjuice_user_log(output, address, data, data_size, topics,
+                               topics_count);
   ckb_debug("END emit_log");
   return;
 }
@@ -765,9 +1957,8 @@ int check_address_collision(gw_context_t* ctx, const uint8_t eth_addr[ETH_ADDRES
   if (ret != 0) {
     return ret;
   }
-  uint8_t code[MAX_DATA_SIZE];
-  uint64_t code_size = MAX_DATA_SIZE;
-  ret = load_account_code(ctx, account_id, &code_size, 0, code);
+  uint64_t code_size = 0;
+  ret = load_account_code_size(ctx, account_id, &code_size);
   if (ret != 0) {
     return ret;
   }
@@ -978,11 +2169,19 @@ int create_new_account(gw_context_t* ctx,
   }
   free(new_script_seg.ptr);
   *to_id = new_account_id;
+  /* the account may have been looked up before it was created */
+  invalidate_account_code(new_account_id);
   memcpy((uint8_t *)msg->destination.bytes, eth_addr, 20);
+  /* EIP-2929: the created address is added to accessed_addresses */
+  ret = mark_address_accessed(eth_addr, NULL);
+  if (ret != 0) {
+    return ret;
+  }
   debug_print_int(">> new to id", *to_id);
 
   // register a created contract account into `ETH Address Registry`
   ret = gw_update_eth_address_register(ctx, eth_addr, script_hash, overwrite);
+  invalidate_eth_address(eth_addr);
   if (ret != 0) {
     ckb_debug("[create_new_account] failed to register a contract account");
     return ret;
@@ -1090,9 +2289,8 @@ int handle_native_token_transfer(gw_context_t* ctx, uint32_t from_id,
         return ret;
     }
 
-    uint8_t code[MAX_DATA_SIZE];
-    uint64_t code_size = MAX_DATA_SIZE;
-    ret = load_account_code(ctx, to_id, &code_size, 0, code);
+    uint64_t code_size = 0;
+    ret = load_account_code_size(ctx, to_id, &code_size);
     if (ret != 0) {
       return ret;
     }
@@ -1136,6 +2334,7 @@ int handle_native_token_transfer(gw_context_t* ctx, uint32_t from_id,
     }
 
     ret = gw_register_eth_address(ctx, account_script_hash);
+    invalidate_eth_address(g_eoa_transfer_to_address.bytes);
     if (ret != 0) {
       ckb_debug("[handle_native_token_transfer] failed to register eth address");
       return ret;
@@ -1155,11 +2354,147 @@ int handle_native_token_transfer(gw_context_t* ctx, uint32_t from_id,
   return 0;
 }
 
+/**
+ * Per-transaction cache of evmone code analysis
+ *
+ * Keyed by the data hash of contract code (see `load_account_code`), so a
+ * contract called several times in one transaction is only analysed once.
+ * The analysis is a few times larger than the code, hence the total code size
+ * of cached entries is bounded. Pinned entries are in use by a running frame
+ * and never evicted.
+ */
+#define ANALYSIS_CACHE_CAPACITY 8
+#define ANALYSIS_CACHE_CODE_BUDGET (2 * MAX_DATA_SIZE)
+typedef struct {
+  bool valid;
+  uint32_t pins;
+  uint8_t data_hash[32];
+  size_t code_size;
+  evmone::code_analysis* analysis;
+} code_analysis_entry_t;
+static code_analysis_entry_t g_analysis_cache[ANALYSIS_CACHE_CAPACITY];
+static size_t g_analysis_cache_code_size = 0;
+#ifdef POLYJUICE_DEBUG_LOG
+static uint32_t g_analysis_cache_hits = 0;
+static uint32_t g_analysis_cache_misses = 0;
+#endif
+
+void free_code_analysis(code_analysis_entry_t* entry) {
+  delete entry->analysis;
+  entry->analysis = NULL;
+}
+
+void init_analysis_cache() {
+  for (size_t i = 0; i < ANALYSIS_CACHE_CAPACITY; i++) {
+    free_code_analysis(&g_analysis_cache[i]);
+  }
+  memset(g_analysis_cache, 0, sizeof(g_analysis_cache));
+  g_analysis_cache_code_size = 0;
+#ifdef POLYJUICE_DEBUG_LOG
+  g_analysis_cache_hits = 0;
+  g_analysis_cache_misses = 0;
+#endif
+}
+
+void evict_code_analysis(code_analysis_entry_t* entry) {
+  g_analysis_cache_code_size -= entry->code_size;
+  free_code_analysis(entry);
+  memset(entry, 0, sizeof(code_analysis_entry_t));
+}
+
+/**
+ * Get the analysis of a loaded contract code, the returned entry must be
+ * released by `release_code_analysis`.
+ */
+code_analysis_entry_t* load_code_analysis(const account_code_t* code) {
+  code_analysis_entry_t* entry = NULL;
+  for (size_t i = 0; i < ANALYSIS_CACHE_CAPACITY; i++) {
+    if (g_analysis_cache[i].valid &&
+        memcmp(g_analysis_cache[i].data_hash, code->data_hash, 32) == 0) {
+#ifdef POLYJUICE_DEBUG_LOG
+      g_analysis_cache_hits++;
+#endif
+      g_analysis_cache[i].pins++;
+      return &g_analysis_cache[i];
+    }
+  }
+#ifdef POLYJUICE_DEBUG_LOG
+  g_analysis_cache_misses++;
+#endif
+
+  /* make room by evicting unpinned entries */
+  size_t code_size = (size_t)code->code_size;
+  for (size_t i = 0; i < ANALYSIS_CACHE_CAPACITY; i++) {
+    code_analysis_entry_t* candidate = &g_analysis_cache[i];
+    if (candidate->valid && candidate->pins == 0 &&
+        g_analysis_cache_code_size + code_size > ANALYSIS_CACHE_CODE_BUDGET) {
+      evict_code_analysis(candidate);
+    }
+  }
+  if (g_analysis_cache_code_size + code_size <= ANALYSIS_CACHE_CODE_BUDGET) {
+    for (size_t i = 0; i < ANALYSIS_CACHE_CAPACITY && entry == NULL; i++) {
+      if (!g_analysis_cache[i].valid) {
+        entry = &g_analysis_cache[i];
+      }
+    }
+    for (size_t i = 0; i < ANALYSIS_CACHE_CAPACITY && entry == NULL; i++) {
+      if (g_analysis_cache[i].pins == 0) {
+        entry = &g_analysis_cache[i];
+        evict_code_analysis(entry);
+      }
+    }
+  }
+
+  if (entry == NULL) {
+    /* uncached entry, freed on release */
+    entry = (code_analysis_entry_t*)malloc(sizeof(code_analysis_entry_t));
+    if (entry == NULL) {
+      return NULL;
+    }
+    memset(entry, 0, sizeof(code_analysis_entry_t));
+  } else {
+    entry->valid = true;
+    memcpy(entry->data_hash, code->data_hash, 32);
+    entry->code_size = code_size;
+    g_analysis_cache_code_size += code_size;
+  }
+  entry->pins = 1;
+  entry->analysis = new evmone::code_analysis(
+      evmone::analyze(EVMC_MAX_REVISION, code->code, code_size));
+  return entry;
+}
+
+void release_code_analysis(code_analysis_entry_t* entry) {
+  entry->pins--;
+  if (!entry->valid) {
+    free_code_analysis(entry);
+    free(entry);
+  }
+}
+
+/**
+ * The evmone VM instance of the current transaction and the host interface
+ * shared by all frames, nested calls only push a new `evmc_host_context`.
+ */
+static struct evmc_vm* g_evmc_vm = NULL;
+/* evmone only calls access_account/access_storage from Berlin on */
+static_assert(EVMC_MAX_REVISION >= EVMC_BERLIN,
+              "the access set needs the EIP-2929 host hooks");
+static const struct evmc_host_interface g_host_interface = {
+    account_exists, get_storage,    set_storage,    get_balance,
+    get_code_size,  get_code_hash,  copy_code,      selfdestruct,
+    call,           get_tx_context, get_block_hash, emit_log,
+    access_account, access_storage};
+
+/**
+ * @param code the loaded contract code, NULL for init code
+ */
 int execute_in_evmone(gw_context_t* ctx,
                       evmc_message* msg,
                       uint32_t _parent_from_id,
                       uint32_t from_id,
                       uint32_t to_id,
+                      const account_code_t* code,
                       const uint8_t* code_data,
                       const size_t code_size,
                       struct evmc_result* res) {
@@ -1167,14 +2502,29 @@ int execute_in_evmone(gw_context_t* ctx,
   evmc_address sender = msg->sender;
   evmc_address destination = msg->destination;
   struct evmc_host_context context {ctx, code_data, code_size, msg->kind, from_id, to_id, sender, destination, 0};
-  struct evmc_vm* vm = evmc_create_evmone();
-  struct evmc_host_interface interface = {account_exists, get_storage,    set_storage,    get_balance,
-                                          get_code_size,  get_code_hash,  copy_code,      selfdestruct,
-                                          call,           get_tx_context, get_block_hash, emit_log};
+  if (g_evmc_vm == NULL) {
+    ckb_debug("[execute_in_evmone] evmone VM was not created");
+    return FATAL_POLYJUICE;
+  }
   /* Execute the code in EVM */
   debug_print_int("[execute_in_evmone] code size", code_size);
   debug_print_int("[execute_in_evmone] input_size", msg->input_size);
-  *res = vm->execute(vm, &interface, &context, EVMC_MAX_REVISION, msg, code_data, code_size);
+  if (code == NULL) {
+    *res = g_evmc_vm->execute(g_evmc_vm, &g_host_interface, &context,
+                              EVMC_MAX_REVISION, msg, code_data, code_size);
+  } else {
+    /* same as evmone::execute, but with a cached analysis */
+    code_analysis_entry_t* analysis = load_code_analysis(code);
+    if (analysis == NULL) {
+      ckb_debug("[execute_in_evmone] load_code_analysis failed");
+      return FATAL_POLYJUICE;
+    }
+    auto state = std::make_unique<evmone::AdvancedExecutionState>(
+        *msg, EVMC_MAX_REVISION, g_host_interface,
+        (evmc_host_context*)&context, code_data, code_size);
+    *res = evmone::execute(*state, *analysis->analysis);
+    release_code_analysis(analysis);
+  }
   if (res->status_code != EVMC_SUCCESS && res->status_code != EVMC_REVERT) {
     res->output_data = NULL;
     res->output_size = 0;
@@ -1182,16 +2532,10 @@ int execute_in_evmone(gw_context_t* ctx,
   if (context.error_code != 0) {
     debug_print_int("[execute_in_evmone] context.error_code", context.error_code);
     ret = context.error_code;
-    goto evmc_vm_cleanup;
-  }
-  if (res->gas_left < 0) {
+  } else if (res->gas_left < 0) {
     ckb_debug("[execute_in_evmone] gas not enough");
     ret = EVMC_OUT_OF_GAS;
-    goto evmc_vm_cleanup;
   }
-
-evmc_vm_cleanup:
-  evmc_destroy(vm); // destroy the VM instance
   return ret;
 }
 
@@ -1217,6 +2561,27 @@ int store_contract_code(gw_context_t* ctx,
   if (ret != 0) {
     return ret;
   }
+  if (res->output_size > 0) {
+    /* memoize keccak256(code) for EXTCODEHASH */
+    union ethash_hash256 code_hash = ethash::keccak256(res->output_data,
+                                                       res->output_size);
+    polyjuice_build_contract_code_hash_key(to_id, key);
+    ret = ctx->sys_store(ctx, to_id, key, GW_KEY_BYTES, code_hash.bytes);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  /* record the code length for EXTCODESIZE, empty code included */
+  uint8_t code_size_value[GW_VALUE_BYTES] = {0};
+  uint32_t code_size = (uint32_t)res->output_size;
+  memcpy(code_size_value, &code_size, sizeof(uint32_t));
+  code_size_value[CODE_SIZE_PRESENT_OFFSET] = CODE_SIZE_PRESENT;
+  polyjuice_build_contract_code_size_key(to_id, key);
+  ret = ctx->sys_store(ctx, to_id, key, GW_KEY_BYTES, code_size_value);
+  if (ret != 0) {
+    return ret;
+  }
+  invalidate_account_code(to_id);
   return 0;
 }
 
@@ -1234,6 +2599,13 @@ int handle_message(gw_context_t* ctx,
 
   evmc_message msg = *msg_origin;
   int ret;
+  /* transient buffers of this frame are reclaimed on exit */
+  size_t arena_mark = tx_arena_mark();
+  /* logs of this frame are dropped unless it succeeds */
+  size_t log_mark = log_buffer_mark();
+  /* and so are its cached state changes */
+  size_t journal_start = journal_mark();
+  uint32_t state_writes = g_state_writes;
 
   bool to_address_exists = false;
   uint32_t to_id = 0;
@@ -1278,10 +2650,10 @@ int handle_message(gw_context_t* ctx,
     }
   }
 
-  /* Load contract code from evmc_message or by sys_load_data */
+  /* Load contract code from evmc_message or from the code cache */
   uint8_t* code_data = NULL;
   size_t code_size = 0;
-  uint8_t code_data_buffer[MAX_DATA_SIZE];
+  account_code_t* code = NULL;
   if (is_create(msg.kind)) {
     /* use input as code */
     code_data = (uint8_t*)msg.input_data;
@@ -1289,33 +2661,34 @@ int handle_message(gw_context_t* ctx,
     msg.input_data = NULL;
     msg.input_size = 0;
   } else if (to_address_exists) {
-    uint64_t code_size_tmp = MAX_DATA_SIZE;
     /* call kind: CALL/CALLCODE/DELEGATECALL */
-    ret = load_account_code(ctx, to_id, &code_size_tmp, 0, code_data_buffer);
+    ret = load_account_code(ctx, to_id, &code);
     if (ret != 0) {
       debug_print_int("[handle_message] load_account_code failed", ret);
       return ret;
     }
-    if (code_size_tmp == 0) {
+    if (code->code_size == 0) {
       debug_print_int("[handle_message] account with empty code (EoA account)",
                       to_id);
-      code_data = NULL;
-    } else {
-      code_data = code_data_buffer;
     }
-    code_size = (size_t)code_size_tmp;
+    /* the entry stays pinned until this message is handled */
+    code_data = code->code;
+    code_size = (size_t)code->code_size;
   } else {
     /** Call non-exists address */
     ckb_debug("[handle_message] Warn: Call non-exists address");
   }
 
+  uint32_t parent_frame = journal_enter_frame();
+
   /* Handle special call: CALLCODE/DELEGATECALL */
   if (is_special_call(msg.kind)) {
     /* This action must after load the contract code */
     to_id = parent_to_id;
     if (parent_destination == NULL) {
       ckb_debug("[handle_message] parent_destination is NULL");
-      return FATAL_POLYJUICE;
+      ret = FATAL_POLYJUICE;
+      goto handle_message_cleanup;
     }
     memcpy(msg.destination.bytes, parent_destination->bytes, 20);
   }
@@ -1325,7 +2698,7 @@ int handle_message(gw_context_t* ctx,
   if (is_create(msg.kind)) {
     ret = create_new_account(ctx, &msg, from_id, &to_id, code_data, code_size);
     if (ret != 0) {
-      return ret;
+      goto handle_message_cleanup;
     }
     to_address_exists = true;
 
@@ -1342,7 +2715,7 @@ int handle_message(gw_context_t* ctx,
     ret = gw_increase_nonce(ctx, from_id, NULL);
     if (ret != 0) {
       debug_print_int("[handle_message] increase nonce failed", ret);
-      return ret;
+      goto handle_message_cleanup;
     }
   }
 
@@ -1359,16 +2732,17 @@ int handle_message(gw_context_t* ctx,
                           || (to_address_exists && code_size == 0);
     ret = handle_transfer(ctx, &msg, to_address_is_eoa);
     if (ret != 0) {
-      return ret;
+      goto handle_message_cleanup;
     }
   }
 
   debug_print_int("[handle_message] msg.kind", msg.kind);
   /* NOTE: msg and res are updated */
   if (to_address_exists && code_size > 0) {
-    ret = execute_in_evmone(ctx, &msg, parent_from_id, from_id, to_id, code_data, code_size, res);
+    ret = execute_in_evmone(ctx, &msg, parent_from_id, from_id, to_id,
+                            code, code_data, code_size, res);
     if (ret != 0) {
-      return ret;
+      goto handle_message_cleanup;
     }
     if (g_error_code != EVMC_SUCCESS) {
       res->status_code = (evmc_status_code)g_error_code;
@@ -1385,7 +2759,7 @@ int handle_message(gw_context_t* ctx,
     /** Store contract code though syscall */
     ret = store_contract_code(ctx, to_id, res);
     if (ret != 0) {
-      return ret;
+      goto handle_message_cleanup;
     }
 
     /**
@@ -1400,8 +2774,23 @@ int handle_message(gw_context_t* ctx,
   debug_print_int("[handle_message] used_memory(Bytes)", used_memory);
   debug_print_int("[handle_message] gas left", res->gas_left);
   debug_print_int("[handle_message] status_code", res->status_code);
+  ret = (int)res->status_code;
 
-  return (int)res->status_code;
+handle_message_cleanup:
+  if (ret != 0) {
+    log_buffer_truncate(log_mark);
+    journal_revert(journal_start);
+    /* the state written directly can not be rolled back, so a failed frame
+     * that wrote any fails the whole transaction, whatever the error is */
+    if (g_state_writes != state_writes) {
+      g_error_code = ret;
+    }
+  }
+  journal_leave_frame(parent_frame);
+  release_account_code(code);
+  record_heap_high_water();
+  tx_arena_reset(arena_mark);
+  return ret;
 }
 
 int emit_evm_result_log(gw_context_t* ctx,
@@ -1501,6 +2890,16 @@ int run_polyjuice() {
 #endif
 
   int ret;
+  init_code_cache();
+  init_address_cache();
+  init_analysis_cache();
+  init_storage_cache();
+  init_journal();
+  init_tx_arena();
+  init_log_buffer();
+#ifdef POLYJUICE_PRECOMPILE_CACHE
+  init_precompile_cache();
+#endif
 
   /* prepare context */
   gw_context_t context;
@@ -1508,6 +2907,8 @@ int run_polyjuice() {
   if (ret != 0) {
     return ret;
   }
+  count_state_writes(&context);
+  buffer_logs(&context);
 
   evmc_message msg;
   /* Parse message */
@@ -1600,6 +3001,16 @@ int run_polyjuice() {
     return ret;
   }
 
+  ret = init_access_set(&msg);
+  if (ret != 0) {
+    return ret;
+  }
+  ret = apply_access_list(&context);
+  if (ret != 0) {
+    debug_print_int("[run_polyjuice] apply_access_list failed", ret);
+    return ret;
+  }
+
   uint8_t evm_memory[MAX_EVM_MEMORY_SIZE];
   init_evm_memory(evm_memory, MAX_EVM_MEMORY_SIZE);
 
@@ -1611,7 +3022,26 @@ int run_polyjuice() {
   int64_t initial_gas = msg.gas;
   msg.gas -= min_gas;                  // subtract IntrinsicGas
 
+  /* one VM instance serves the whole call tree of this transaction */
+  g_evmc_vm = evmc_create_evmone();
   int ret_handle_message = handle_message(&context, UINT32_MAX, UINT32_MAX, NULL, &msg, &res);
+  evmc_destroy(g_evmc_vm);
+  g_evmc_vm = NULL;
+#ifdef POLYJUICE_DEBUG_LOG
+  debug_print_int("[run_polyjuice] analysis cache hits", g_analysis_cache_hits);
+  debug_print_int("[run_polyjuice] analysis cache misses",
+                  g_analysis_cache_misses);
+  record_heap_high_water();
+  debug_print_int("[run_polyjuice] heap high-water(Bytes)", g_heap_high_water);
+  debug_print_int("[run_polyjuice] tx arena high-water(Bytes)",
+                  g_tx_arena_high_water);
+#endif
+#if defined(POLYJUICE_PRECOMPILE_CACHE) && defined(POLYJUICE_DEBUG_LOG)
+  debug_print_int("[run_polyjuice] precompile cache hits",
+                  g_precompile_cache_hits);
+  debug_print_int("[run_polyjuice] precompile cache misses",
+                  g_precompile_cache_misses);
+#endif
   // debug_print evmc_result.output_data if the execution failed
   if (res.status_code != 0) {
     debug_print_int("evmc_result.output_size", res.output_size);
@@ -1630,7 +3060,12 @@ int run_polyjuice() {
       (uint64_t)(res.gas_left <= 0 ? initial_gas : initial_gas - res.gas_left);
   debug_print_int("[run_polyjuice] gas_used", gas_used);
 
-  /* emit POLYJUICE_SYSTEM log to Godwoken */
+  /* logs of the frames that succeeded, then the POLYJUICE_SYSTEM log */
+  ret = flush_logs(&context);
+  if (ret != 0) {
+    ckb_debug("flush_logs failed");
+    return clean_evmc_result_and_return(&res, ret);
+  }
   ret = emit_evm_result_log(&context, gas_used, res.status_code);
   if (ret != 0) {
     ckb_debug("emit_evm_result_log failed");
@@ -1666,7 +3101,11 @@ int run_polyjuice() {
     return clean_evmc_result_and_return(&res, ret);
   }
 
-  /* finalize state */
+  /* write back contract storage, then finalize state */
+  ret = flush_storage_cache(&context);
+  if (ret != 0) {
+    return clean_evmc_result_and_return(&res, ret);
+  }
   ckb_debug("[run_polyjuice] finalize");
   ret = gw_finalize(&context);
   if (ret != 0) {
@@ -24,5 +24,7 @@
 #define ERROR_CONTRACT_ADDRESS_COLLISION        -92
 #define ERROR_INSUFFICIENT_GAS_LIMIT            -93
 #define ERROR_NATIVE_TOKEN_TRANSFER             -94
+#define ERROR_BATCH_ECRECOVER                   -95
+#define ERROR_LOG_BUFFER_FULL                   -97
 
 #endif // POLYJUICE_ERRORS_H
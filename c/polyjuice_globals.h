@@ -47,6 +47,14 @@ static uint128_t g_gas_price = UINT128_MAX;
 static bool g_eoa_transfer_flag = false;
 static evmc_address g_eoa_transfer_to_address = {0};
 
+/**
+ * EIP-2930 access list of the transaction, points into the tx args.
+ * See `parse_access_list`
+ */
+static const uint8_t *g_access_list = NULL;
+static uint32_t g_access_list_addresses = 0;
+static uint32_t g_access_list_storage_keys = 0;
+
 static int g_error_code = 0;
 
 /* Minimal gas of a normal transaction*/
@@ -59,5 +67,9 @@ static int g_error_code = 0;
 #define	DATA_ZERO_TX_GAS                4
 /* Gas of new account creation*/
 #define NEW_ACCOUNT_GAS                 25000
+/* Gas per address in the access list of a transaction (EIP-2930) */
+#define ACCESS_LIST_ADDRESS_GAS         2400
+/* Gas per storage key in the access list of a transaction (EIP-2930) */
+#define ACCESS_LIST_STORAGE_KEY_GAS     1900
 
 #endif // POLYJUICE_GLOBALS_H
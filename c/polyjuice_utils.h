@@ -8,6 +8,7 @@
 #include "ckb_syscalls.h"
 #include "polyjuice_errors.h"
 #include "polyjuice_globals.h"
+#include "tx_arena.h"
 
 #ifdef POLYJUICE_DEBUG_LOG
 /* 64 KB */
@@ -109,9 +110,129 @@ int build_script(const uint8_t code_hash[32], const uint8_t hash_type,
 }
 
 /**
- * @param script_hash should have been initialed as zero_hash = {0}
+ * Per-transaction cache of eth_address <-> script_hash <-> account_id
+ *
+ * An open-addressing table keyed by eth_address with linear probing. Negative
+ * entries remember addresses not registered yet, so they must be invalidated
+ * by `invalidate_eth_address` whenever an address is (re-)mapped.
  *
- * TODO: shall we cache the mapping data in Polyjuice memory?
+ * Live entries and tombstones together stay under 3/4 of the table, so a miss
+ * always ends at an empty slot: tombstones are reused on insert and dropped by
+ * rebuilding the table when it would fill up, and once the live entries alone
+ * reach the bound new addresses are simply not cached.
+ */
+#define ADDRESS_CACHE_CAPACITY 64 /* must be a power of 2 */
+#define ADDRESS_CACHE_MAX_LOAD (ADDRESS_CACHE_CAPACITY * 3 / 4)
+#define ADDRESS_CACHE_EMPTY 0
+#define ADDRESS_CACHE_TOMBSTONE 1
+#define ADDRESS_CACHE_FOUND 2
+#define ADDRESS_CACHE_NOT_FOUND 3
+typedef struct {
+  uint8_t state;
+  bool has_account_id;
+  uint8_t eth_address[ETH_ADDRESS_LEN];
+  uint8_t script_hash[32];
+  uint32_t account_id;
+} address_cache_entry_t;
+static address_cache_entry_t g_address_cache[ADDRESS_CACHE_CAPACITY];
+static uint32_t g_address_cache_live = 0;
+static uint32_t g_address_cache_tombstones = 0;
+
+void init_address_cache() {
+  memset(g_address_cache, 0, sizeof(g_address_cache));
+  g_address_cache_live = 0;
+  g_address_cache_tombstones = 0;
+}
+
+uint32_t address_cache_slot(const uint8_t eth_address[ETH_ADDRESS_LEN]) {
+  /* eth_address is (part of) a keccak256 hash in most cases */
+  uint32_t h;
+  memcpy(&h, eth_address + ETH_ADDRESS_LEN - sizeof(uint32_t), sizeof(h));
+  return h & (ADDRESS_CACHE_CAPACITY - 1);
+}
+
+address_cache_entry_t *
+lookup_address_cache(const uint8_t eth_address[ETH_ADDRESS_LEN]) {
+  uint32_t slot = address_cache_slot(eth_address);
+  for (size_t i = 0; i < ADDRESS_CACHE_CAPACITY; i++) {
+    address_cache_entry_t *entry =
+        &g_address_cache[(slot + i) & (ADDRESS_CACHE_CAPACITY - 1)];
+    if (entry->state == ADDRESS_CACHE_EMPTY) {
+      return NULL;
+    }
+    if (entry->state != ADDRESS_CACHE_TOMBSTONE &&
+        memcmp(entry->eth_address, eth_address, ETH_ADDRESS_LEN) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+address_cache_entry_t *
+find_free_address_cache_slot(const uint8_t eth_address[ETH_ADDRESS_LEN]) {
+  uint32_t slot = address_cache_slot(eth_address);
+  for (size_t i = 0; i < ADDRESS_CACHE_CAPACITY; i++) {
+    address_cache_entry_t *entry =
+        &g_address_cache[(slot + i) & (ADDRESS_CACHE_CAPACITY - 1)];
+    if (entry->state == ADDRESS_CACHE_EMPTY ||
+        entry->state == ADDRESS_CACHE_TOMBSTONE) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* Re-insert the live entries, dropping all tombstones */
+void rebuild_address_cache() {
+  address_cache_entry_t old[ADDRESS_CACHE_CAPACITY];
+  memcpy(old, g_address_cache, sizeof(g_address_cache));
+  memset(g_address_cache, 0, sizeof(g_address_cache));
+  for (size_t i = 0; i < ADDRESS_CACHE_CAPACITY; i++) {
+    if (old[i].state == ADDRESS_CACHE_FOUND ||
+        old[i].state == ADDRESS_CACHE_NOT_FOUND) {
+      *find_free_address_cache_slot(old[i].eth_address) = old[i];
+    }
+  }
+  g_address_cache_tombstones = 0;
+}
+
+/* Must only be called after a lookup miss, returns NULL when the table is full */
+address_cache_entry_t *
+insert_address_cache(const uint8_t eth_address[ETH_ADDRESS_LEN],
+                     uint8_t state) {
+  if (g_address_cache_live + g_address_cache_tombstones >=
+      ADDRESS_CACHE_MAX_LOAD) {
+    if (g_address_cache_live >= ADDRESS_CACHE_MAX_LOAD) {
+      return NULL;
+    }
+    rebuild_address_cache();
+  }
+  address_cache_entry_t *entry = find_free_address_cache_slot(eth_address);
+  if (entry->state == ADDRESS_CACHE_TOMBSTONE) {
+    g_address_cache_tombstones--;
+  }
+  memset(entry, 0, sizeof(address_cache_entry_t));
+  entry->state = state;
+  memcpy(entry->eth_address, eth_address, ETH_ADDRESS_LEN);
+  g_address_cache_live++;
+  return entry;
+}
+
+/**
+ * Drop the cached mapping of `eth_address`, must be called after the address
+ * is registered or re-mapped in the ETH Address Registry.
+ */
+void invalidate_eth_address(const uint8_t eth_address[ETH_ADDRESS_LEN]) {
+  address_cache_entry_t *entry = lookup_address_cache(eth_address);
+  if (entry != NULL) {
+    entry->state = ADDRESS_CACHE_TOMBSTONE;
+    g_address_cache_live--;
+    g_address_cache_tombstones++;
+  }
+}
+
+/**
+ * @param script_hash should have been initialed as zero_hash = {0}
  */
 int load_script_hash_by_eth_address(gw_context_t *ctx,
                                     const uint8_t eth_address[ETH_ADDRESS_LEN],
@@ -120,17 +241,34 @@ int load_script_hash_by_eth_address(gw_context_t *ctx,
     return GW_FATAL_INVALID_CONTEXT;
   }
 
+  address_cache_entry_t *entry = lookup_address_cache(eth_address);
+  if (entry != NULL) {
+    if (entry->state == ADDRESS_CACHE_NOT_FOUND) {
+      return GW_ERROR_NOT_FOUND;
+    }
+    memcpy(script_hash, entry->script_hash, 32);
+    return 0;
+  }
+
   gw_reg_addr_t addr = new_reg_addr(eth_address);
 
   int ret = ctx->sys_get_script_hash_by_registry_address(ctx, &addr, script_hash);
+  if (ret == 0 && _is_zero_hash(script_hash)) {
+    ret = GW_ERROR_NOT_FOUND;
+  }
+  if (ret == GW_ERROR_NOT_FOUND) {
+    insert_address_cache(eth_address, ADDRESS_CACHE_NOT_FOUND);
+    return ret;
+  }
   if (ret != 0) {
     return ret;
   }
-  if (_is_zero_hash(script_hash)) {
-    return GW_ERROR_NOT_FOUND;
+  entry = insert_address_cache(eth_address, ADDRESS_CACHE_FOUND);
+  if (entry != NULL) {
+    memcpy(entry->script_hash, script_hash, 32);
   }
-  return 0;
   ckb_debug("load_script_hash_by_eth_address success");
+  return 0;
 }
 
 int load_eth_address_by_script_hash(gw_context_t *ctx,
@@ -140,6 +278,17 @@ int load_eth_address_by_script_hash(gw_context_t *ctx,
     return GW_FATAL_INVALID_CONTEXT;
   }
 
+  /* a plain scan: this only runs for the sender and the destination in
+   * parse_args, before execution has filled the table */
+  for (size_t i = 0; i < ADDRESS_CACHE_CAPACITY; i++) {
+    address_cache_entry_t *entry = &g_address_cache[i];
+    if (entry->state == ADDRESS_CACHE_FOUND &&
+        memcmp(entry->script_hash, script_hash, 32) == 0) {
+      _gw_fast_memcpy(eth_address, entry->eth_address, ETH_ADDRESS_LEN);
+      return 0;
+    }
+  }
+
   /* build addr */
   gw_reg_addr_t addr = new_reg_addr(eth_address);
 
@@ -152,6 +301,13 @@ int load_eth_address_by_script_hash(gw_context_t *ctx,
   }
 
   _gw_fast_memcpy(eth_address, addr.addr, ETH_ADDRESS_LEN);
+  if (lookup_address_cache(eth_address) == NULL) {
+    address_cache_entry_t *entry =
+        insert_address_cache(eth_address, ADDRESS_CACHE_FOUND);
+    if (entry != NULL) {
+      memcpy(entry->script_hash, script_hash, 32);
+    }
+  }
   return 0;
 }
 
@@ -175,7 +331,20 @@ int load_account_id_by_eth_address(gw_context_t *ctx, const uint8_t address[20],
                      address, ETH_ADDRESS_LEN);
     return ret;
   }
-  return ctx->sys_get_account_id_by_script_hash(ctx, script_hash, account_id);
+  address_cache_entry_t *entry = lookup_address_cache(address);
+  if (entry != NULL && entry->has_account_id) {
+    *account_id = entry->account_id;
+    return 0;
+  }
+  ret = ctx->sys_get_account_id_by_script_hash(ctx, script_hash, account_id);
+  if (ret != 0) {
+    return ret;
+  }
+  if (entry != NULL) {
+    entry->account_id = *account_id;
+    entry->has_account_id = true;
+  }
+  return 0;
 }
 
 void rlp_encode_sender_and_nonce(const evmc_address *sender, uint32_t nonce,
@@ -318,6 +487,76 @@ bool is_evmc_error(int error_code) {
   return error_code >= 1 && error_code <= 16;
 }
 
+/**
+ * Parsed view of a pre-compiled contract input. A gas function that has to
+ * parse its input anyway may fill it in and set `ready`, call() then hands
+ * the same handle to the contract function. Contract functions must still
+ * accept NULL or a handle that is not ready, and parse input_src themselves.
+ */
+typedef struct {
+  bool ready;
+  /* bigModExp: declared operand lengths and zero-copy views into input_src,
+   * *_avail is how many bytes of the operand are actually present, the rest
+   * reads as zero */
+  struct {
+    size_t base_size;
+    size_t exp_size;
+    size_t mod_size;
+    const uint8_t* base;
+    const uint8_t* exp;
+    const uint8_t* mod;
+    size_t base_avail;
+    size_t exp_avail;
+    size_t mod_avail;
+  } mod_exp;
+} precompiled_input_t;
+
+/* ownership of precompiled_output_t.data */
+#define PRECOMPILED_OUTPUT_HEAP 0     /* tx_alloc'ed, tx_free'd with the result */
+#define PRECOMPILED_OUTPUT_BORROWED 1 /* outlives the call, never freed */
+
+/**
+ * Output of a pre-compiled contract. A contract may hand out a borrowed view
+ * of memory that outlives the call instead of allocating, it must not point
+ * into the caller's EVM memory: evmone memcpy()s the output back into that
+ * memory, possibly over an overlapping range.
+ */
+typedef struct {
+  const uint8_t* data;
+  size_t size;
+  uint8_t ownership;
+} precompiled_output_t;
+
+void init_precompiled_output(precompiled_output_t* output) {
+  output->data = NULL;
+  output->size = 0;
+  output->ownership = PRECOMPILED_OUTPUT_HEAP;
+}
+
+/* a writable buffer of `size` bytes for the output, NULL if out of memory */
+uint8_t* alloc_precompiled_output(precompiled_output_t* output, size_t size) {
+  uint8_t* buffer = (uint8_t*)tx_alloc(size);
+  output->ownership = PRECOMPILED_OUTPUT_HEAP;
+  output->data = buffer;
+  return buffer;
+}
+
+void borrow_precompiled_output(precompiled_output_t* output,
+                               const uint8_t* data, size_t size) {
+  output->data = data;
+  output->size = size;
+  output->ownership = PRECOMPILED_OUTPUT_BORROWED;
+}
+
+void free_precompiled_output(precompiled_output_t* output) {
+  if (output->ownership == PRECOMPILED_OUTPUT_HEAP) {
+    tx_free(output->data);
+  }
+  output->data = NULL;
+  output->size = 0;
+  output->ownership = PRECOMPILED_OUTPUT_HEAP;
+}
+
 /**
  * @brief computes the 'intrinsic gas' for a message with the given data
  * 
@@ -353,6 +592,15 @@ int intrinsic_gas(const evmc_message *msg, const bool is_create,
     *min_gas += zero_bytes * DATA_ZERO_TX_GAS;
   }
 
+  // EIP-2930 access list
+  uint64_t access_list_gas =
+      (uint64_t)g_access_list_addresses * ACCESS_LIST_ADDRESS_GAS +
+      (uint64_t)g_access_list_storage_keys * ACCESS_LIST_STORAGE_KEY_GAS;
+  if (UINT64_MAX - *min_gas < access_list_gas) {
+    return ERROR_INSUFFICIENT_GAS_LIMIT;
+  }
+  *min_gas += access_list_gas;
+
   return 0;
 }
 
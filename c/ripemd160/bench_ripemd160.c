@@ -0,0 +1,59 @@
+#include "ripemd160.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Cycles/byte benchmark of ripemd160(). The cycle counter is rdcycle on
+ * RISC-V and rdtsc on x86-64; other targets fall back to nanoseconds.
+ */
+#if defined(__riscv)
+#define COUNTER_UNIT "cycles"
+static uint64_t read_counter() {
+  uint64_t cycles;
+  asm volatile("rdcycle %0" : "=r"(cycles));
+  return cycles;
+}
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#define COUNTER_UNIT "cycles"
+static uint64_t read_counter() { return __rdtsc(); }
+#else
+#define COUNTER_UNIT "ns"
+static uint64_t read_counter() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/* total bytes hashed per message size */
+#define BENCH_TOTAL_BYTES (4 * 1024 * 1024)
+
+int main() {
+  static const uint32_t sizes[] = {32, 64, 100, 1024, 16 * 1024};
+  uint8_t *msg = (uint8_t *)malloc(16 * 1024 + 1);
+  for (uint32_t i = 0; i < 16 * 1024 + 1; i++) {
+    msg[i] = (uint8_t)(i * 131 + 7);
+  }
+
+  uint8_t hash[RIPEMD160_DIGEST_LENGTH] = {0};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    for (int offset = 0; offset <= 1; offset++) {
+      uint32_t size = sizes[s];
+      uint32_t iterations = BENCH_TOTAL_BYTES / size;
+      uint64_t start = read_counter();
+      for (uint32_t n = 0; n < iterations; n++) {
+        ripemd160(msg + offset, size, hash);
+        msg[offset] ^= hash[0];
+      }
+      uint64_t elapsed = read_counter() - start;
+      printf("%6u bytes (%s) %8.2f %s/byte\n", size,
+             offset == 0 ? "aligned  " : "unaligned",
+             (double)elapsed / ((double)iterations * size), COUNTER_UNIT);
+    }
+  }
+  free(msg);
+  return 0;
+}
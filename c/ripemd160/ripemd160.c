@@ -56,7 +56,7 @@
  * RIPEMD-160 context setup
  */
 void ripemd160_Init(RIPEMD160_CTX* ctx) {
-  memzero(ctx, sizeof(RIPEMD160_CTX));
+  /* buffer is always written before it is read, no need to clear it */
   ctx->total[0] = 0;
   ctx->total[1] = 0;
   ctx->state[0] = 0x67452301;
@@ -74,6 +74,16 @@ void ripemd160_process(RIPEMD160_CTX* ctx,
                        const uint8_t data[RIPEMD160_BLOCK_LENGTH]) {
   uint32_t A, B, C, D, E, Ap, Bp, Cp, Dp, Ep, X[16];
 
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  /* the block is already in the right word order. On strict-alignment
+   * targets such as RISC-V an unaligned memcpy is still done bytewise, so
+   * aligned blocks take a path the compiler can turn into word loads. */
+  if (((uintptr_t)data & 3) == 0) {
+    memcpy(X, __builtin_assume_aligned(data, 4), RIPEMD160_BLOCK_LENGTH);
+  } else {
+    memcpy(X, data, RIPEMD160_BLOCK_LENGTH);
+  }
+#else
   GET_UINT32_LE(X[0], data, 0);
   GET_UINT32_LE(X[1], data, 4);
   GET_UINT32_LE(X[2], data, 8);
@@ -90,6 +100,7 @@ void ripemd160_process(RIPEMD160_CTX* ctx,
   GET_UINT32_LE(X[13], data, 52);
   GET_UINT32_LE(X[14], data, 56);
   GET_UINT32_LE(X[15], data, 60);
+#endif
 
   A = Ap = ctx->state[0];
   B = Bp = ctx->state[1];
@@ -326,6 +337,34 @@ void ripemd160(const uint8_t* msg, uint32_t msg_len,
                uint8_t hash[RIPEMD160_DIGEST_LENGTH]) {
   RIPEMD160_CTX ctx;
   ripemd160_Init(&ctx);
-  ripemd160_Update(&ctx, msg, msg_len);
-  ripemd160_Final(&ctx, hash);
+
+  /* whole blocks are processed in place, without going through ctx.buffer */
+  uint32_t full_len = msg_len & ~(uint32_t)(RIPEMD160_BLOCK_LENGTH - 1);
+  for (uint32_t offset = 0; offset < full_len;
+       offset += RIPEMD160_BLOCK_LENGTH) {
+    ripemd160_process(&ctx, msg + offset);
+  }
+
+  /* the remaining bytes, padding and bit length fit in at most two blocks */
+  uint32_t tail_words[RIPEMD160_BLOCK_LENGTH * 2 / 4];
+  uint8_t* tail = (uint8_t*)tail_words;
+  uint32_t left = msg_len - full_len;
+  uint32_t tail_len = (left < 56) ? RIPEMD160_BLOCK_LENGTH
+                                  : RIPEMD160_BLOCK_LENGTH * 2;
+  if (left > 0) {
+    memcpy(tail, msg + full_len, left);
+  }
+  memcpy(tail + left, ripemd160_padding, tail_len - 8 - left);
+  PUT_UINT32_LE(msg_len << 3, tail, tail_len - 8);
+  PUT_UINT32_LE(msg_len >> 29, tail, tail_len - 4);
+  ripemd160_process(&ctx, tail);
+  if (tail_len > RIPEMD160_BLOCK_LENGTH) {
+    ripemd160_process(&ctx, tail + RIPEMD160_BLOCK_LENGTH);
+  }
+
+  PUT_UINT32_LE(ctx.state[0], hash, 0);
+  PUT_UINT32_LE(ctx.state[1], hash, 4);
+  PUT_UINT32_LE(ctx.state[2], hash, 8);
+  PUT_UINT32_LE(ctx.state[3], hash, 12);
+  PUT_UINT32_LE(ctx.state[4], hash, 16);
 }
@@ -0,0 +1,261 @@
+#ifndef SHA256_BLOCKS_H_
+#define SHA256_BLOCKS_H_
+
+/*
+ * Word-oriented SHA-256 used by the sha256hash precompile (0x02).
+ *
+ * Whole 64-byte blocks are compressed straight from the input buffer, only
+ * the final padded block(s) go through a local buffer. sha256_compress is
+ * the block function: on x86 hosts whose CPU reports the SHA extensions
+ * (checked once with cpuid) it uses SHA-NI, otherwise it runs the fully
+ * unrolled scalar version, which is what the RISC-V build on ckb-vm runs.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHA256_HAS_SHANI_PATH 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#define SHA256_BLOCK_BYTES 64
+#define SHA256_DIGEST_BYTES 32
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define SHA256_BSIG0(x) (SHA256_ROTR(x, 2) ^ SHA256_ROTR(x, 13) ^ SHA256_ROTR(x, 22))
+#define SHA256_BSIG1(x) (SHA256_ROTR(x, 6) ^ SHA256_ROTR(x, 11) ^ SHA256_ROTR(x, 25))
+#define SHA256_SSIG0(x) (SHA256_ROTR(x, 7) ^ SHA256_ROTR(x, 18) ^ ((x) >> 3))
+#define SHA256_SSIG1(x) (SHA256_ROTR(x, 17) ^ SHA256_ROTR(x, 19) ^ ((x) >> 10))
+#define SHA256_CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA256_MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+#define SHA256_LOAD_BE32(p)                                          \
+  ((uint32_t)(p)[0] << 24 | (uint32_t)(p)[1] << 16 |                 \
+   (uint32_t)(p)[2] << 8 | (uint32_t)(p)[3])
+
+/* message schedule kept in a 16-word ring, w[i & 15] holds W[i] */
+#define SHA256_W(i)                                                  \
+  (w[(i) & 15] += SHA256_SSIG1(w[((i) - 2) & 15]) +                  \
+                  w[((i) - 7) & 15] + SHA256_SSIG0(w[((i) - 15) & 15]))
+
+/*
+ * The eight working variables rotate through the macro arguments instead of
+ * being shifted, so a round only writes d and h.
+ */
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i, wi)                  \
+  do {                                                               \
+    uint32_t t1 = h + SHA256_BSIG1(e) + SHA256_CH(e, f, g) +         \
+                  sha256_k[i] + (wi);                                \
+    d += t1;                                                         \
+    h = t1 + SHA256_BSIG0(a) + SHA256_MAJ(a, b, c);                  \
+  } while (0)
+
+#define SHA256_ROUNDS8(i, W)                                         \
+  do {                                                               \
+    SHA256_ROUND(a, b, c, d, e, f, g, h, (i) + 0, W((i) + 0));       \
+    SHA256_ROUND(h, a, b, c, d, e, f, g, (i) + 1, W((i) + 1));       \
+    SHA256_ROUND(g, h, a, b, c, d, e, f, (i) + 2, W((i) + 2));       \
+    SHA256_ROUND(f, g, h, a, b, c, d, e, (i) + 3, W((i) + 3));       \
+    SHA256_ROUND(e, f, g, h, a, b, c, d, (i) + 4, W((i) + 4));       \
+    SHA256_ROUND(d, e, f, g, h, a, b, c, (i) + 5, W((i) + 5));       \
+    SHA256_ROUND(c, d, e, f, g, h, a, b, (i) + 6, W((i) + 6));       \
+    SHA256_ROUND(b, c, d, e, f, g, h, a, (i) + 7, W((i) + 7));       \
+  } while (0)
+
+#define SHA256_W_LOADED(i) w[i]
+
+/* Fully unrolled scalar compression of `count` consecutive blocks */
+void sha256_compress_generic(uint32_t state[8], const uint8_t* blocks,
+                             size_t count) {
+  uint32_t w[16];
+  for (; count > 0; count--, blocks += SHA256_BLOCK_BYTES) {
+    for (int i = 0; i < 16; i++) {
+      w[i] = SHA256_LOAD_BE32(blocks + i * 4);
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    SHA256_ROUNDS8(0, SHA256_W_LOADED);
+    SHA256_ROUNDS8(8, SHA256_W_LOADED);
+    SHA256_ROUNDS8(16, SHA256_W);
+    SHA256_ROUNDS8(24, SHA256_W);
+    SHA256_ROUNDS8(32, SHA256_W);
+    SHA256_ROUNDS8(40, SHA256_W);
+    SHA256_ROUNDS8(48, SHA256_W);
+    SHA256_ROUNDS8(56, SHA256_W);
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+#ifdef SHA256_HAS_SHANI_PATH
+/*
+ * Four rounds with the SHA extensions. `mc` holds W[i..i+3], `mp` the
+ * previous four words and `mn` the next group, which is finished here with
+ * sha256msg2. `mp` then gets its sha256msg1 step for the group after next.
+ */
+#define SHA256_SHANI_QUAD(i, mc, mp, mn)                                   \
+  do {                                                                     \
+    msg = _mm_add_epi32(mc,                                                \
+                        _mm_loadu_si128((const __m128i*)&sha256_k[i]));    \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);                   \
+    mn = _mm_sha256msg2_epu32(                                             \
+        _mm_add_epi32(mn, _mm_alignr_epi8(mc, mp, 4)), mc);                \
+    msg = _mm_shuffle_epi32(msg, 0x0E);                                    \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);                   \
+    mp = _mm_sha256msg1_epu32(mp, mc);                                     \
+  } while (0)
+
+/* four rounds of the last groups, no schedule words left to expand */
+#define SHA256_SHANI_TAIL(i, mc)                                           \
+  do {                                                                     \
+    msg = _mm_add_epi32(mc,                                                \
+                        _mm_loadu_si128((const __m128i*)&sha256_k[i]));    \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);                   \
+    msg = _mm_shuffle_epi32(msg, 0x0E);                                    \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);                   \
+  } while (0)
+
+__attribute__((target("sha,sse4.1"))) void sha256_compress_shani(
+    uint32_t state[8], const uint8_t* blocks, size_t count) {
+  const __m128i mask =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i msg, msg0, msg1, msg2, msg3;
+
+  /* the SHA instructions want the state as ABEF and CDGH */
+  __m128i tmp = _mm_loadu_si128((const __m128i*)&state[0]);
+  __m128i state1 = _mm_loadu_si128((const __m128i*)&state[4]);
+  tmp = _mm_shuffle_epi32(tmp, 0xB1);
+  state1 = _mm_shuffle_epi32(state1, 0x1B);
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+  for (; count > 0; count--, blocks += SHA256_BLOCK_BYTES) {
+    const __m128i abef_save = state0;
+    const __m128i cdgh_save = state1;
+
+    msg0 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*)(blocks + 0)), mask);
+    msg1 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*)(blocks + 16)), mask);
+    msg2 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*)(blocks + 32)), mask);
+    msg3 = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*)(blocks + 48)), mask);
+
+    SHA256_SHANI_TAIL(0, msg0);
+    SHA256_SHANI_TAIL(4, msg1);
+    msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+    SHA256_SHANI_TAIL(8, msg2);
+    msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+    SHA256_SHANI_QUAD(12, msg3, msg2, msg0);
+    SHA256_SHANI_QUAD(16, msg0, msg3, msg1);
+    SHA256_SHANI_QUAD(20, msg1, msg0, msg2);
+    SHA256_SHANI_QUAD(24, msg2, msg1, msg3);
+    SHA256_SHANI_QUAD(28, msg3, msg2, msg0);
+    SHA256_SHANI_QUAD(32, msg0, msg3, msg1);
+    SHA256_SHANI_QUAD(36, msg1, msg0, msg2);
+    SHA256_SHANI_QUAD(40, msg2, msg1, msg3);
+    SHA256_SHANI_QUAD(44, msg3, msg2, msg0);
+    SHA256_SHANI_QUAD(48, msg0, msg3, msg1);
+    SHA256_SHANI_QUAD(52, msg1, msg0, msg2);
+    SHA256_SHANI_QUAD(56, msg2, msg1, msg3);
+    SHA256_SHANI_TAIL(60, msg3);
+
+    state0 = _mm_add_epi32(state0, abef_save);
+    state1 = _mm_add_epi32(state1, cdgh_save);
+  }
+
+  /* back to ABCD and EFGH */
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+  state1 = _mm_alignr_epi8(state1, tmp, 8);
+  _mm_storeu_si128((__m128i*)&state[0], state0);
+  _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+/* CPUID.(EAX=7,ECX=0):EBX bit 29 reports the SHA extensions */
+bool sha256_shani_supported() {
+  static int supported = -1;
+  if (supported < 0) {
+    unsigned int eax, ebx, ecx, edx;
+    supported = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+                (ebx & (1u << 29)) != 0;
+  }
+  return supported == 1;
+}
+#endif /* SHA256_HAS_SHANI_PATH */
+
+void sha256_compress(uint32_t state[8], const uint8_t* blocks, size_t count) {
+#ifdef SHA256_HAS_SHANI_PATH
+  if (sha256_shani_supported()) {
+    sha256_compress_shani(state, blocks, count);
+    return;
+  }
+#endif
+  sha256_compress_generic(state, blocks, count);
+}
+
+/* One-shot SHA-256 of `data`, the digest is written to `out` (32 bytes) */
+void sha256_digest(const uint8_t* data, size_t len, uint8_t* out) {
+  uint32_t state[8];
+  memcpy(state, sha256_iv, sizeof(state));
+
+  size_t full_blocks = len / SHA256_BLOCK_BYTES;
+  sha256_compress(state, data, full_blocks);
+
+  /* padding: 0x80, zeros, then the bit length as a 64-bit big-endian */
+  uint8_t tail[SHA256_BLOCK_BYTES * 2] = {0};
+  size_t rest = len % SHA256_BLOCK_BYTES;
+  if (rest > 0) {
+    memcpy(tail, data + full_blocks * SHA256_BLOCK_BYTES, rest);
+  }
+  tail[rest] = 0x80;
+  size_t tail_blocks = rest < SHA256_BLOCK_BYTES - 8 ? 1 : 2;
+  uint64_t bit_len = (uint64_t)len * 8;
+  uint8_t* end = tail + tail_blocks * SHA256_BLOCK_BYTES;
+  for (int i = 1; i <= 8; i++) {
+    end[-i] = (uint8_t)(bit_len >> (8 * (i - 1)));
+  }
+  sha256_compress(state, tail, tail_blocks);
+
+  for (int i = 0; i < 8; i++) {
+    out[i * 4 + 0] = (uint8_t)(state[i] >> 24);
+    out[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+    out[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+    out[i * 4 + 3] = (uint8_t)(state[i]);
+  }
+}
+
+#endif /* SHA256_BLOCKS_H_ */
@@ -9,7 +9,8 @@
 #define TRANSFER_TO_ANY_SUDT_GAS 300
 
 int balance_of_any_sudt_gas(const uint8_t* input_src, const size_t input_size,
-                            uint64_t* gas) {
+                            uint64_t* gas,
+                            precompiled_input_t* parsed) {
   *gas = BALANCE_OF_ANY_SUDT_GAS;
   return 0;
 }
@@ -31,7 +32,8 @@ int balance_of_any_sudt(gw_context_t* ctx, const uint8_t* code_data,
                         const enum evmc_call_kind parent_kind,
                         bool is_static_call,
                         const uint8_t* input_src, const size_t input_size,
-                        uint8_t** output, size_t* output_size) {
+                        precompiled_output_t* output,
+                        const precompiled_input_t* parsed) {
   int ret;
   if (input_size != (32 + 32)) {
     return ERROR_BALANCE_OF_ANY_SUDT;
@@ -44,13 +46,13 @@ int balance_of_any_sudt(gw_context_t* ctx, const uint8_t* code_data,
   }
 
   // Default return zero balance
-  *output = (uint8_t*)malloc(32);
-  if (*output == NULL) {
+  uint8_t* out = alloc_precompiled_output(output, 32);
+  if (out == NULL) {
     ckb_debug("[balance_of_any_sudt] malloc failed");
     return FATAL_PRECOMPILED_CONTRACTS;
   }
-  *output_size = 32;
-  memset(*output, 0, 32);
+  output->size = 32;
+  memset(out, 0, 32);
 
   for (int i = 0; i < 12; i++) {
     if (input_src[32 + i] != 0) {
@@ -75,12 +77,13 @@ int balance_of_any_sudt(gw_context_t* ctx, const uint8_t* code_data,
       return ERROR_BALANCE_OF_ANY_SUDT;
     }
   }
-  put_u256(balance, *output);
+  put_u256(balance, out);
   return 0;
 }
 
 int total_supply_of_any_sudt_gas(const uint8_t* input_src,
-                                 const size_t input_size, uint64_t* gas) {
+                                 const size_t input_size, uint64_t* gas,
+                                 precompiled_input_t* parsed) {
   *gas = TOTAL_SUPPLY_OF_ANY_SUDT_GAS;
   return 0;
 }
@@ -101,7 +104,8 @@ int total_supply_of_any_sudt(gw_context_t* ctx, const uint8_t* code_data,
                              const enum evmc_call_kind parent_kind,
                              bool is_static_call,
                              const uint8_t* input_src, const size_t input_size,
-                             uint8_t** output, size_t* output_size) {
+                             precompiled_output_t* output,
+                             const precompiled_input_t* parsed) {
   int ret;
   if (input_size != 32) {
     return ERROR_TOTAL_SUPPLY_OF_ANY_SUDT;
@@ -114,13 +118,13 @@ int total_supply_of_any_sudt(gw_context_t* ctx, const uint8_t* code_data,
   }
 
   // Default return zero total supply
-  *output = (uint8_t*)malloc(32);
-  if (*output == NULL) {
+  uint8_t* out = alloc_precompiled_output(output, 32);
+  if (out == NULL) {
     ckb_debug("malloc failed");
     return FATAL_PRECOMPILED_CONTRACTS;
   }
-  *output_size = 32;
-  memset(*output, 0, 32);
+  output->size = 32;
+  memset(out, 0, 32);
 
   uint256_t total_supply_le = {0};
   ret = sudt_get_total_supply(ctx, sudt_id, &total_supply_le);
@@ -138,13 +142,14 @@ int total_supply_of_any_sudt(gw_context_t* ctx, const uint8_t* code_data,
 
   uint8_t* total_supply_le_bytes = (uint8_t*)&total_supply_le;
   for (size_t i = 0; i < 32; i++) {
-    (*output)[31 - i] = total_supply_le_bytes[i];
+    out[31 - i] = total_supply_le_bytes[i];
   }
   return 0;
 }
 
 int transfer_to_any_sudt_gas(const uint8_t* input_src, const size_t input_size,
-                             uint64_t* gas) {
+                             uint64_t* gas,
+                             precompiled_input_t* parsed) {
   *gas = TRANSFER_TO_ANY_SUDT_GAS;
   return 0;
 }
@@ -170,7 +175,8 @@ int transfer_to_any_sudt(gw_context_t* ctx, const uint8_t* code_data,
                          const enum evmc_call_kind parent_kind,
                          bool is_static_call,
                          const uint8_t* input_src, const size_t input_size,
-                         uint8_t** output, size_t* output_size) {
+                         precompiled_output_t* output,
+                         const precompiled_input_t* parsed) {
   /* Contract code hash of `SudtERC20Proxy_UserDefinedDecimals.ContractCode`
      => 0xde4542f5a5bd32c09cd98e9752281f88900a059aab7ac103edd9df214f136c52 */
   static const uint8_t
@@ -232,8 +238,8 @@ int transfer_to_any_sudt(gw_context_t* ctx, const uint8_t* code_data,
     }
   }
 
-  *output = NULL;
-  *output_size = 0;
+  output->data = NULL;
+  output->size = 0;
   return 0;
 }
 
@@ -0,0 +1,134 @@
+/*
+ * Throughput benchmark of the SHA-256 block functions in sha256_blocks.h
+ * against the byte-oriented crypto-algorithms implementation the sha256hash
+ * precompile used before. Digests are checked against known vectors and the
+ * block functions against each other before anything is timed.
+ *
+ * Build and run on the host with `make bench-sha256`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sha256.h"
+#include "sha256_blocks.h"
+
+#define BENCH_BUFFER_SIZE (64 * 1024)
+#define BENCH_REPEAT 256
+
+static const struct {
+  const char* message;
+  size_t repeat;
+  const char* expected;
+} vectors[] = {
+    {"", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {"abc", 1,
+     "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+     "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    {"a", 1000000,
+     "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+};
+
+static void hex(const uint8_t* data, size_t len, char* out) {
+  for (size_t i = 0; i < len; i++) {
+    sprintf(out + i * 2, "%02x", data[i]);
+  }
+}
+
+static double now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char* name, double elapsed) {
+  double bytes = (double)BENCH_BUFFER_SIZE * BENCH_REPEAT;
+  printf("%-24s %8.2f MB/s\n", name, bytes / elapsed / 1e6);
+}
+
+static void bench_crypto_algorithms(const uint8_t* buffer) {
+  uint8_t digest[SHA256_DIGEST_BYTES];
+  double start = now_seconds();
+  for (int n = 0; n < BENCH_REPEAT; n++) {
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, buffer, BENCH_BUFFER_SIZE);
+    sha256_final(&ctx, digest);
+  }
+  report("crypto-algorithms", now_seconds() - start);
+}
+
+static void bench_compress(const char* name,
+                           void (*compress)(uint32_t*, const uint8_t*, size_t),
+                           const uint8_t* buffer, uint32_t state[8]) {
+  memcpy(state, sha256_iv, sizeof(uint32_t) * 8);
+  double start = now_seconds();
+  for (int n = 0; n < BENCH_REPEAT; n++) {
+    compress(state, buffer, BENCH_BUFFER_SIZE / SHA256_BLOCK_BYTES);
+  }
+  report(name, now_seconds() - start);
+}
+
+int main() {
+  int failed = 0;
+  for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+    size_t part = strlen(vectors[v].message);
+    size_t len = part * vectors[v].repeat;
+    uint8_t* message = (uint8_t*)malloc(len + 1);
+    for (size_t i = 0; i < vectors[v].repeat; i++) {
+      memcpy(message + i * part, vectors[v].message, part);
+    }
+    uint8_t digest[SHA256_DIGEST_BYTES];
+    char digest_hex[SHA256_DIGEST_BYTES * 2 + 1];
+    sha256_digest(message, len, digest);
+    hex(digest, sizeof(digest), digest_hex);
+    if (strcmp(digest_hex, vectors[v].expected) != 0) {
+      printf("sha256_digest: wrong digest on vector %zu: %s\n", v, digest_hex);
+      failed = 1;
+    }
+    free(message);
+  }
+
+  uint8_t* buffer = (uint8_t*)malloc(BENCH_BUFFER_SIZE);
+  srand(1);
+  for (size_t i = 0; i < BENCH_BUFFER_SIZE; i++) {
+    buffer[i] = (uint8_t)rand();
+  }
+
+  /* every length up to a few blocks must agree with crypto-algorithms */
+  for (size_t len = 0; len <= 4 * SHA256_BLOCK_BYTES; len++) {
+    uint8_t expected[SHA256_DIGEST_BYTES], actual[SHA256_DIGEST_BYTES];
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, buffer, len);
+    sha256_final(&ctx, expected);
+    sha256_digest(buffer, len, actual);
+    if (memcmp(expected, actual, sizeof(expected)) != 0) {
+      printf("sha256_digest: mismatch at length %zu\n", len);
+      failed = 1;
+      break;
+    }
+  }
+
+  uint32_t generic_state[8];
+  bench_crypto_algorithms(buffer);
+  bench_compress("sha256_compress_generic", sha256_compress_generic, buffer,
+                 generic_state);
+#ifdef SHA256_HAS_SHANI_PATH
+  if (sha256_shani_supported()) {
+    uint32_t state[8];
+    bench_compress("sha256_compress_shani", sha256_compress_shani, buffer,
+                   state);
+    if (memcmp(state, generic_state, sizeof(state)) != 0) {
+      printf("sha256_compress_shani: state differs from generic\n");
+      failed = 1;
+    }
+  } else {
+    printf("sha256_compress_shani: SHA extensions not supported\n");
+  }
+#endif
+  free(buffer);
+  return failed;
+}
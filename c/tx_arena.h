@@ -0,0 +1,117 @@
+#ifndef TX_ARENA_H_
+#define TX_ARENA_H_
+
+/*
+ * Per-transaction bump arena for transient buffers
+ *
+ * Pre-compiled contract outputs and similar scratch buffers live for a few
+ * instructions at most, going through newlib malloc for each of them is slow
+ * on ckb-vm and fragments the 3MB heap. They are bump-allocated from a small
+ * arena instead:
+ *
+ * - the arena is malloc'ed by the first tx_alloc(), a transaction that never
+ *   calls a pre-compiled contract does not pay for it
+ * - only one output is live per frame, fixed-size outputs are at most 64
+ *   bytes, so 4KB also covers the usual identity/modexp outputs
+ * - tx_alloc() falls back to malloc once the arena is full, tx_free() takes
+ *   either kind of pointer
+ * - tx_free() of the most recent allocation pops it, everything else is
+ *   reclaimed when the enclosing frame resets to its mark
+ * - handle_message() takes a mark on entry and resets to it on exit, so a
+ *   frame never leaks arena space to its caller
+ *
+ * Nothing that outlives a call frame (code cache, memo cache, buffered user
+ * logs, ...) may be allocated here.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#ifdef POLYJUICE_DEBUG_LOG
+#include <unistd.h>
+#endif
+
+#define TX_ARENA_SIZE (4 * 1024)
+#define TX_ARENA_ALIGN 8
+
+/* malloc'ed on first use, malloc() memory is aligned to TX_ARENA_ALIGN */
+static uint8_t* g_tx_arena = NULL;
+static size_t g_tx_arena_top = 0;
+/* start of the most recent allocation, SIZE_MAX once it has been popped */
+static size_t g_tx_arena_last = SIZE_MAX;
+#ifdef POLYJUICE_DEBUG_LOG
+static size_t g_tx_arena_high_water = 0;
+static uint8_t* g_heap_start = NULL;
+static size_t g_heap_high_water = 0;
+#endif
+
+void init_tx_arena() {
+  g_tx_arena_top = 0;
+  g_tx_arena_last = SIZE_MAX;
+#ifdef POLYJUICE_DEBUG_LOG
+  g_tx_arena_high_water = 0;
+  g_heap_start = (uint8_t*)sbrk(0);
+  g_heap_high_water = 0;
+#endif
+}
+
+size_t tx_arena_mark() { return g_tx_arena_top; }
+
+void tx_arena_reset(size_t mark) {
+  if (mark < g_tx_arena_top) {
+    g_tx_arena_top = mark;
+  }
+  g_tx_arena_last = SIZE_MAX;
+}
+
+bool tx_arena_owns(const void* ptr) {
+  return g_tx_arena != NULL && (const uint8_t*)ptr >= g_tx_arena &&
+         (const uint8_t*)ptr < g_tx_arena + TX_ARENA_SIZE;
+}
+
+void* tx_alloc(size_t size) {
+  size_t aligned = (size + TX_ARENA_ALIGN - 1) & ~(size_t)(TX_ARENA_ALIGN - 1);
+  if (g_tx_arena == NULL && aligned >= size && aligned <= TX_ARENA_SIZE) {
+    g_tx_arena = (uint8_t*)malloc(TX_ARENA_SIZE);
+  }
+  if (g_tx_arena != NULL && aligned >= size && aligned <= TX_ARENA_SIZE - g_tx_arena_top) {
+    void* ptr = g_tx_arena + g_tx_arena_top;
+    g_tx_arena_last = g_tx_arena_top;
+    g_tx_arena_top += aligned;
+#ifdef POLYJUICE_DEBUG_LOG
+    if (g_tx_arena_top > g_tx_arena_high_water) {
+      g_tx_arena_high_water = g_tx_arena_top;
+    }
+#endif
+    return ptr;
+  }
+  return malloc(size);
+}
+
+void tx_free(const void* ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+  if (!tx_arena_owns(ptr)) {
+    free((void*)ptr);
+    return;
+  }
+  size_t offset = (size_t)((const uint8_t*)ptr - g_tx_arena);
+  if (offset == g_tx_arena_last) {
+    g_tx_arena_top = offset;
+    g_tx_arena_last = SIZE_MAX;
+  }
+}
+
+/* track the peak of the newlib heap (program break), debug builds only */
+void record_heap_high_water() {
+#ifdef POLYJUICE_DEBUG_LOG
+  uint8_t* brk = (uint8_t*)sbrk(0);
+  if (g_heap_start != NULL && brk > g_heap_start &&
+      (size_t)(brk - g_heap_start) > g_heap_high_water) {
+    g_heap_high_water = (size_t)(brk - g_heap_start);
+  }
+#endif
+}
+
+#endif /* TX_ARENA_H_ */
@@ -315,6 +315,11 @@ impl MockChain {
         Ok(nonce)
     }
 
+    pub fn get_storage(&self, account_id: u32, key: &H256) -> anyhow::Result<H256> {
+        let value = self.ctx.state.get_value(account_id, key)?;
+        Ok(value)
+    }
+
     pub fn to_reg_addr(eth_address: &[u8; 20]) -> RegistryAddress {
         RegistryAddress::new(ETH_REGISTRY_ACCOUNT_ID, eth_address.to_vec())
     }
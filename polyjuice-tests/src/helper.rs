@@ -334,6 +334,7 @@ pub struct PolyjuiceArgsBuilder {
     value: u128,
     input: Vec<u8>,
     to_address: Option<[u8; 20]>,
+    access_list: Option<Vec<([u8; 20], Vec<[u8; 32]>)>>,
 }
 
 impl PolyjuiceArgsBuilder {
@@ -362,9 +363,19 @@ impl PolyjuiceArgsBuilder {
         self.to_address = Some(to_address);
         self
     }
+    /// EIP-2930 access list: (address, storage keys), flagged in the call kind
+    /// byte as the args of a type 1 transaction
+    pub fn access_list(mut self, access_list: Vec<([u8; 20], Vec<[u8; 32]>)>) -> Self {
+        self.access_list = Some(access_list);
+        self
+    }
     pub fn build(self) -> Vec<u8> {
         let mut output: Vec<u8> = vec![0u8; 52];
-        let call_kind: u8 = if self.is_create { 3 } else { 0 };
+        let mut call_kind: u8 = if self.is_create { 3 } else { 0 };
+        if self.access_list.is_some() {
+            // POLYJUICE_ARGS_ACCESS_LIST
+            call_kind |= 0x80;
+        }
         output[0..8].copy_from_slice(&[0xff, 0xff, 0xff, b'P', b'O', b'L', b'Y', call_kind][..]);
         output[8..16].copy_from_slice(&self.gas_limit.to_le_bytes()[..]);
         output[16..32].copy_from_slice(&self.gas_price.to_le_bytes()[..]);
@@ -374,6 +385,16 @@ impl PolyjuiceArgsBuilder {
         if let Some(to_address) = self.to_address {
             output.extend_from_slice(&to_address);
         }
+        if let Some(access_list) = self.access_list {
+            output.extend_from_slice(&(access_list.len() as u32).to_le_bytes()[..]);
+            for (address, keys) in access_list {
+                output.extend_from_slice(&address);
+                output.extend_from_slice(&(keys.len() as u32).to_le_bytes()[..]);
+                for key in keys {
+                    output.extend_from_slice(&key);
+                }
+            }
+        }
         output
     }
 }
@@ -829,6 +850,16 @@ pub(crate) fn eth_address_regiser(
     )
 }
 
+/// Gas used by the transaction, from its PolyjuiceSystem log
+pub(crate) fn get_gas_used(logs: &[LogItem]) -> u64 {
+    logs.iter()
+        .find_map(|log| match parse_log(log) {
+            Log::PolyjuiceSystem { gas_used, .. } => Some(gas_used),
+            _ => None,
+        })
+        .expect("PolyjuiceSystem log")
+}
+
 pub(crate) fn print_gas_used(operation: &str, logs: &Vec<LogItem>) {
     let mut gas_used: Option<u64> = None;
     for log in logs {
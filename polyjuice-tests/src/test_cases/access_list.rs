@@ -0,0 +1,106 @@
+//! Test EIP-2930 access list in Polyjuice args
+//!   See ./evm-contracts/SimpleStorage.sol
+
+use std::convert::TryInto;
+
+use gw_types::{
+    packed::RawL2Transaction,
+    prelude::{Builder, Entity, Pack},
+};
+
+use crate::{
+    ctx::MockChain,
+    helper::{get_gas_used, MockContractInfo, PolyjuiceArgsBuilder},
+};
+
+const INIT_CODE: &str = include_str!("./evm-contracts/SimpleStorage.bin");
+
+#[test]
+fn access_list_test() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let from_addr = [1u8; 20];
+    let from_id = chain.create_eoa_account(&from_addr, 1000000.into())?;
+    let _ = chain.deploy(from_id, &hex::decode(INIT_CODE)?, 200000, 1, 0)?;
+    let contract_info = MockContractInfo::create(&from_addr, 0);
+    let contract_eth_addr: [u8; 20] = contract_info.eth_addr.try_into().unwrap();
+    let contract_account_id = chain
+        .get_account_id_by_eth_address(&contract_eth_addr)?
+        .expect("contract account id");
+
+    // SimpleStorage.set(0x0d10), with and without `storedData` (slot 0) in
+    // the access list, from the same state
+    let input =
+        hex::decode("60fe47b10000000000000000000000000000000000000000000000000000000000000d10")?;
+    let set_tx = |access_list: Option<Vec<([u8; 20], Vec<[u8; 32]>)>>| {
+        let mut builder = PolyjuiceArgsBuilder::default()
+            .gas_limit(100000)
+            .gas_price(1)
+            .value(0)
+            .input(&input);
+        if let Some(access_list) = access_list {
+            builder = builder.access_list(access_list);
+        }
+        RawL2Transaction::new_builder()
+            .from_id(from_id.pack())
+            .to_id(contract_account_id.pack())
+            .args(ckb_vm::Bytes::from(builder.build()).pack())
+            .build()
+    };
+    let access_list = vec![(contract_eth_addr, vec![[0u8; 32]])];
+    let run_result = chain.call(set_tx(None))?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let gas_used_without = get_gas_used(&run_result.write.logs);
+    let run_result = chain.call(set_tx(Some(access_list.clone())))?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let gas_used_with = get_gas_used(&run_result.write.logs);
+    // intrinsic gas of 2400 for the address and 1900 for the key, the address
+    // is the destination and already warm, the SSTORE saves the cold 2100
+    assert_eq!(gas_used_with, gas_used_without + 2400 + 1900 - 2100);
+    let run_result = chain.execute_raw(set_tx(Some(access_list)))?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    assert_eq!(get_gas_used(&run_result.write.logs), gas_used_with);
+
+    // SimpleStorage.get()
+    let input = hex::decode("6d4ce63c")?;
+    let run_result = chain.execute(from_id, contract_account_id, &input, 100000, 1, 0)?;
+    let mut expected_return_data = vec![0u8; 32];
+    expected_return_data[30] = 0x0d;
+    expected_return_data[31] = 0x10;
+    assert_eq!(run_result.return_data.as_ref(), &expected_return_data[..]);
+
+    // a truncated access list is rejected
+    let mut args = PolyjuiceArgsBuilder::default()
+        .gas_limit(100000)
+        .gas_price(1)
+        .value(0)
+        .input(&input)
+        .access_list(vec![(contract_eth_addr, vec![[0u8; 32]])])
+        .build();
+    args.pop();
+    let raw_tx = RawL2Transaction::new_builder()
+        .from_id(from_id.pack())
+        .to_id(contract_account_id.pack())
+        .args(ckb_vm::Bytes::from(args).pack())
+        .build();
+    let result = chain.execute_raw(raw_tx);
+    assert!(result.is_err() || result.unwrap().exit_code != 0);
+
+    // an access list appended to the args of a legacy transaction, without
+    // the POLYJUICE_ARGS_ACCESS_LIST flag, is rejected
+    let mut args = PolyjuiceArgsBuilder::default()
+        .gas_limit(100000)
+        .gas_price(1)
+        .value(0)
+        .input(&input)
+        .access_list(vec![(contract_eth_addr, vec![[0u8; 32]])])
+        .build();
+    args[7] &= !0x80;
+    let raw_tx = RawL2Transaction::new_builder()
+        .from_id(from_id.pack())
+        .to_id(contract_account_id.pack())
+        .args(ckb_vm::Bytes::from(args).pack())
+        .build();
+    let run_result = chain.call(raw_tx)?;
+    assert_eq!(run_result.exit_code, -1);
+    Ok(())
+}
@@ -0,0 +1,155 @@
+//! Test the EIP-2929 accessed addresses and storage keys of a transaction:
+//! the exact gas of cold and warm accesses, and a reverted frame leaving the
+//! addresses and slots it warmed cold again
+
+use crate::{
+    ctx::MockChain,
+    helper::{get_gas_used, MockContractInfo},
+};
+
+/// Deploy `runtime` from `from_eth_addr` and return the eth address and
+/// account id of the contract
+fn deploy_runtime(
+    chain: &mut MockChain,
+    from_eth_addr: &[u8; 20],
+    runtime: &[u8],
+) -> anyhow::Result<(Vec<u8>, u32)> {
+    let from_id = chain
+        .get_account_id_by_eth_address(from_eth_addr)?
+        .expect("from account id");
+    let nonce = chain.get_nonce(from_id)?;
+    let mut code = hex::decode(format!("60{:02x}80600b6000396000f3", runtime.len()))?;
+    code.extend_from_slice(runtime);
+    let run_result = chain.deploy(from_id, &code, 200000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let contract = MockContractInfo::create(from_eth_addr, nonce);
+    let contract_id = chain
+        .get_account_id_by_script_hash(&contract.script_hash)?
+        .expect("contract account id");
+    Ok((contract.eth_addr, contract_id))
+}
+
+/// Call `to_id` with empty calldata and return the gas used
+fn gas_used_by_call(
+    chain: &mut MockChain,
+    from_eth_addr: &[u8; 20],
+    to_id: u32,
+) -> anyhow::Result<u64> {
+    let from_id = chain
+        .get_account_id_by_eth_address(from_eth_addr)?
+        .expect("from account id");
+    let run_result = chain.execute(from_id, to_id, &[], 100000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    Ok(get_gas_used(&run_result.write.logs))
+}
+
+/// `SLOAD(0); POP; SLOAD(0); POP`
+#[test]
+fn test_sload_cold_then_warm() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let (_, contract_id) = deploy_runtime(
+        &mut chain,
+        &from_eth_addr,
+        &hex::decode("6000545060005450")?,
+    )?;
+    let gas_used = gas_used_by_call(&mut chain, &from_eth_addr, contract_id)?;
+    assert_eq!(gas_used, 21000 + (3 + 2100 + 2) + (3 + 100 + 2));
+    Ok(())
+}
+
+/// `CALL(callee); POP; CALL(callee); POP` where the callee only STOPs
+#[test]
+fn test_call_cold_then_warm() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let (callee_eth_addr, _) = deploy_runtime(&mut chain, &from_eth_addr, &[0x00])?;
+    // PUSH1 0 (x5); PUSH20 callee; GAS; CALL; POP
+    let call = format!(
+        "6000600060006000600073{}5af150",
+        hex::encode(&callee_eth_addr)
+    );
+    let runtime = hex::decode(call.repeat(2))?;
+    let (_, caller_id) = deploy_runtime(&mut chain, &from_eth_addr, &runtime)?;
+    let gas_used = gas_used_by_call(&mut chain, &from_eth_addr, caller_id)?;
+    assert_eq!(gas_used, 21000 + (20 + 2600 + 2) + (20 + 100 + 2));
+    Ok(())
+}
+
+/// Deploy a callee that only STOPs, then a contract running `runtime(callee)`
+/// and return the gas used by calling it
+fn gas_used_with_callee(runtime: impl Fn(&str) -> String) -> anyhow::Result<u64> {
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let (callee_eth_addr, _) = deploy_runtime(&mut chain, &from_eth_addr, &[0x00])?;
+    let runtime = hex::decode(runtime(&hex::encode(&callee_eth_addr)))?;
+    let (_, contract_id) = deploy_runtime(&mut chain, &from_eth_addr, &runtime)?;
+    gas_used_by_call(&mut chain, &from_eth_addr, contract_id)
+}
+
+/// `EXTCODESIZE(callee); POP; EXTCODESIZE(callee); POP`
+#[test]
+fn test_extcodesize_cold_then_warm() -> anyhow::Result<()> {
+    let gas_used = gas_used_with_callee(|callee| format!("73{}3b50", callee).repeat(2))?;
+    assert_eq!(gas_used, 21000 + (3 + 2600 + 2) + (3 + 100 + 2));
+    Ok(())
+}
+
+/// `BALANCE(callee); POP; BALANCE(callee); POP`
+#[test]
+fn test_balance_cold_then_warm() -> anyhow::Result<()> {
+    let gas_used = gas_used_with_callee(|callee| format!("73{}3150", callee).repeat(2))?;
+    assert_eq!(gas_used, 21000 + (3 + 2600 + 2) + (3 + 100 + 2));
+    Ok(())
+}
+
+/// `BALANCE(callee); POP; EXTCODESIZE(callee); POP; CALL(callee); POP`: the
+/// address warmed by BALANCE stays warm for the other opcodes
+#[test]
+fn test_address_warm_across_opcodes() -> anyhow::Result<()> {
+    let gas_used = gas_used_with_callee(|callee| {
+        format!("73{0}315073{0}3b506000600060006000600073{0}5af150", callee)
+    })?;
+    assert_eq!(
+        gas_used,
+        21000 + (3 + 2600 + 2) + (3 + 100 + 2) + (20 + 100 + 2)
+    );
+    Ok(())
+}
+
+/// Calls itself with 1 byte calldata, the sub-call reads slot 0 and the
+/// balance of 0x0202..02 then reverts, and the caller reads them again.
+///
+/// Runtime code:
+/// ```text
+/// 00 CALLDATASIZE; PUSH1 0x2e; JUMPI
+/// 04 PUSH1 0; PUSH1 0; PUSH1 1; PUSH1 0; PUSH1 0; ADDRESS; GAS; CALL; POP
+/// 12 PUSH1 0; SLOAD; POP; PUSH20 0x0202..02; BALANCE; POP; STOP
+/// 2e JUMPDEST; PUSH1 0; SLOAD; POP; PUSH20 0x0202..02; BALANCE; POP
+/// 4a PUSH1 0; DUP1; REVERT
+/// ```
+const REVERTED_ACCESS_CODE: &str = "36602e5760006000600160006000305af1506000545073020202\
+                                    02020202020202020202020202020202023150005b6000545073\
+                                    02020202020202020202020202020202020202023150600080fd";
+
+/// The slot and address warmed by a reverted sub-call are cold again
+#[test]
+fn test_reverted_sub_call_access() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let runtime = hex::decode(REVERTED_ACCESS_CODE)?;
+    let (_, contract_id) = deploy_runtime(&mut chain, &from_eth_addr, &runtime)?;
+    let gas_used = gas_used_by_call(&mut chain, &from_eth_addr, contract_id)?;
+    // CALL arguments and 1 word of memory, warm CALL to itself
+    let call = 15 + 19 + 3 + 100;
+    // JUMPDEST, cold SLOAD and BALANCE, PUSH1 0; DUP1; REVERT
+    let sub_call = 16 + (3 + 2100 + 2) + (3 + 2600 + 2) + 6;
+    // POP, cold SLOAD and BALANCE again
+    let after_revert = 2 + (3 + 2100 + 2) + (3 + 2600 + 2);
+    assert_eq!(gas_used, 21000 + call + sub_call + after_revert);
+    Ok(())
+}
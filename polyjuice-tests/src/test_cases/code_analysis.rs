@@ -0,0 +1,175 @@
+//! Test the per-transaction cache of evmone code analysis
+
+use crate::{
+    ctx::MockChain,
+    helper::{MockContractInfo, L2TX_MAX_CYCLES},
+};
+use gw_types::U256;
+
+const MULTICALL3_CODE: &str = include_str!("./evm-contracts/Multicall3.bin");
+
+/// Calls `calldata[0..32]` with `calldata[32..]` and returns its return data.
+///
+/// Runtime code:
+/// ```text
+/// 00 PUSH1 0x20; CALLDATASIZE; SUB
+/// 04 DUP1; PUSH1 0x20; PUSH1 0; CALLDATACOPY
+/// 0a PUSH1 0; PUSH1 0; DUP3; PUSH1 0; PUSH1 0; PUSH1 0; CALLDATALOAD; GAS; CALL
+/// 19 RETURNDATASIZE; PUSH1 0; PUSH1 0; RETURNDATACOPY; PUSH1 0x25; JUMPI
+/// 21 RETURNDATASIZE; PUSH1 0; REVERT
+/// 25 JUMPDEST; RETURNDATASIZE; PUSH1 0; RETURN
+/// ```
+const FORWARDER_CODE: &str = "602a80600b6000396000f3\
+                              602036038060206000376000600082600060006000355af1\
+                              3d600060003e6025573d6000fd5b3d6000f3";
+
+/// Init code of a contract returning `id` as uint256, padded with JUMPDEST to
+/// `code_size` bytes.
+///
+/// Runtime code: `PUSH2 id; PUSH1 0; MSTORE; PUSH1 0x20; PUSH1 0; RETURN`
+fn returns_id_code(id: u16, code_size: usize) -> Vec<u8> {
+    let mut code = hex::decode(format!(
+        "61{:04x}80600c6000396000f361{:04x}60005260206000f3",
+        code_size, id
+    ))
+    .unwrap();
+    code.resize(12 + code_size, 0x5b);
+    code
+}
+
+/// Multicall3.aggregate((address,bytes)[]) input
+fn aggregate_input(target: &[u8], calls: &[Vec<u8>]) -> Vec<u8> {
+    let mut heads = Vec::new();
+    let mut tails = Vec::new();
+    for call_data in calls {
+        heads.extend_from_slice(&word(calls.len() * 32 + tails.len()));
+        tails.extend_from_slice(&address_word(target));
+        tails.extend_from_slice(&word(0x40));
+        tails.extend_from_slice(&word(call_data.len()));
+        tails.extend_from_slice(call_data);
+        tails.resize((tails.len() + 31) / 32 * 32, 0);
+    }
+    let mut input = hex::decode("252dba42").unwrap();
+    input.extend_from_slice(&word(0x20));
+    input.extend_from_slice(&word(calls.len()));
+    input.extend(heads);
+    input.extend(tails);
+    input
+}
+
+/// returnData of Multicall3.aggregate as uint256
+fn aggregate_output(output: &[u8]) -> Vec<U256> {
+    let read = |offset: usize| U256::from_big_endian(&output[offset..offset + 32]);
+    let len = read(0x40).as_usize();
+    (0..len)
+        .map(|i| {
+            let item = 0x60 + read(0x60 + i * 32).as_usize();
+            assert_eq!(read(item), U256::from(32));
+            read(item + 32)
+        })
+        .collect()
+}
+
+fn word(value: usize) -> [u8; 32] {
+    let mut buf = [0u8; 32];
+    U256::from(value).to_big_endian(&mut buf);
+    buf
+}
+
+fn address_word(eth_addr: &[u8]) -> [u8; 32] {
+    let mut buf = [0u8; 32];
+    buf[12..].copy_from_slice(eth_addr);
+    buf
+}
+
+/// One transaction calls 13 distinct contracts of 4000 bytes, directly and
+/// through a nested forwarder, from a Multicall3 frame. Their analyses do not
+/// fit the cache together, so entries are evicted while the forwarder and
+/// Multicall3 stay pinned by their running frames, and the forwarder is
+/// pinned twice when it calls itself.
+#[test]
+fn test_analysis_cache_pin_and_evict() -> anyhow::Result<()> {
+    const TARGETS: u16 = 13;
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    let from_id = chain.create_eoa_account(&from_eth_addr, 100000000u64.into())?;
+    for id in 0..TARGETS {
+        let run_result = chain.deploy(from_id, &returns_id_code(id, 4000), 2000000, 1, 0)?;
+        assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    }
+    let run_result = chain.deploy(from_id, &hex::decode(FORWARDER_CODE)?, 100000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let run_result = chain.deploy(from_id, &hex::decode(MULTICALL3_CODE)?, 2000000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let forwarder = MockContractInfo::create(&from_eth_addr, TARGETS as u32);
+    let multicall = MockContractInfo::create(&from_eth_addr, TARGETS as u32 + 1);
+    let multicall_id = chain
+        .get_account_id_by_script_hash(&multicall.script_hash)?
+        .expect("contract account id");
+
+    // forwarder -> target_i, then forwarder -> forwarder -> target_i
+    let targets: Vec<[u8; 32]> = (0..TARGETS as u32)
+        .map(|nonce| address_word(&MockContractInfo::create(&from_eth_addr, nonce).eth_addr))
+        .collect();
+    let mut calls: Vec<Vec<u8>> = targets.iter().map(|target| target.to_vec()).collect();
+    for target in targets.iter() {
+        let mut call_data = address_word(&forwarder.eth_addr).to_vec();
+        call_data.extend_from_slice(target);
+        calls.push(call_data);
+    }
+    let input = aggregate_input(&forwarder.eth_addr, &calls);
+    chain.set_max_cycles(L2TX_MAX_CYCLES * 4);
+    let run_result = chain.execute(from_id, multicall_id, &input, 10000000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let expected: Vec<U256> = (0..2)
+        .flat_map(|_| (0..TARGETS).map(U256::from))
+        .collect();
+    assert_eq!(aggregate_output(&run_result.return_data), expected);
+    Ok(())
+}
+
+/// The analysis of a 20KB contract is built once per transaction, so calling
+/// it again costs about as much as calling a small contract again, and much
+/// less than the first call.
+#[test]
+fn bench_call_large_contract_repeatedly() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    let from_id = chain.create_eoa_account(&from_eth_addr, 100000000u64.into())?;
+    for code_size in [20480, 100].iter() {
+        let run_result = chain.deploy(from_id, &returns_id_code(0, *code_size), 2000000, 1, 0)?;
+        assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    }
+    let run_result = chain.deploy(from_id, &hex::decode(MULTICALL3_CODE)?, 2000000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let large = MockContractInfo::create(&from_eth_addr, 0);
+    let small = MockContractInfo::create(&from_eth_addr, 1);
+    let multicall = MockContractInfo::create(&from_eth_addr, 2);
+    let multicall_id = chain
+        .get_account_id_by_script_hash(&multicall.script_hash)?
+        .expect("contract account id");
+
+    let mut call_cycles = |target: &[u8], calls: usize| -> anyhow::Result<u64> {
+        let input = aggregate_input(target, &vec![Vec::new(); calls]);
+        let run_result = chain.execute(from_id, multicall_id, &input, 1000000, 1, 0)?;
+        assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+        assert_eq!(aggregate_output(&run_result.return_data), vec![U256::zero(); calls]);
+        Ok(run_result.cycles.execution + run_result.cycles.r#virtual)
+    };
+    let no_call = call_cycles(&large.eth_addr, 0)?;
+    let large_once = call_cycles(&large.eth_addr, 1)?;
+    let large_9_times = call_cycles(&large.eth_addr, 9)?;
+    let small_once = call_cycles(&small.eth_addr, 1)?;
+    let small_9_times = call_cycles(&small.eth_addr, 9)?;
+    let large_first = large_once - no_call;
+    let large_repeat = (large_9_times - large_once) / 8;
+    let small_repeat = (small_9_times - small_once) / 8;
+    println!(
+        "[bench_call_large_contract_repeatedly] 20KB contract: first call {} cycles, \
+         repeated call {} cycles, 100B contract: repeated call {} cycles",
+        large_first, large_repeat, small_repeat
+    );
+    assert!(large_repeat < large_first);
+    assert!(large_repeat < small_repeat * 3 / 2);
+    Ok(())
+}
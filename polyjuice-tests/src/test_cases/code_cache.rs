@@ -0,0 +1,143 @@
+//! Test the per-transaction code cache when contracts are created and
+//! destructed by the transaction that reads them
+
+use crate::{
+    ctx::MockChain,
+    helper::{compute_create2_script, contract_script_to_eth_addr, MockContractInfo},
+};
+use gw_types::U256;
+use std::convert::TryInto;
+
+/// Returns 42 for empty calldata, selfdestructs to its caller otherwise.
+///
+/// Runtime code:
+/// ```text
+/// 00 CALLDATASIZE; PUSH1 0x0e; JUMPI
+/// 04 PUSH1 0x2a; PUSH1 0; MSTORE; PUSH1 0x20; PUSH1 0; RETURN
+/// 0e JUMPDEST; CALLER; SELFDESTRUCT
+/// ```
+const CHILD_INIT_CODE: &str = "601180600b6000396000f336600e57602a60005260206000f35b33ff";
+const CHILD_CODE_SIZE: u64 = 17;
+
+/// factory(bytes32 salt, address child, bool destruct) without selector,
+/// CREATE2s CHILD_INIT_CODE (appended to the code) and returns uint256[]:
+///
+/// ```text
+/// [0] EXTCODESIZE(child) before CREATE2
+/// [1] CREATE2(salt)
+/// [2] EXTCODESIZE(child)
+/// [3] success of CALL(child)
+/// [4] return value of CALL(child)
+/// ```
+///
+/// If `destruct` is set, it goes on to destruct the child and CREATE2 it
+/// again in the same transaction:
+///
+/// ```text
+/// [5] success of CALL(child) with 1 byte calldata, which selfdestructs
+/// [6] CREATE2(salt) again
+/// [7] EXTCODESIZE(child)
+/// [8] EXTCODEHASH(child)
+/// ```
+const FACTORY_CODE: &str = "609480600b6000396000f3\
+                            6020353b600052601c61007861010039600035601c6101006000f5\
+                            6020526020353b604052602060806000600060006020355af16060\
+                            52604035604257\
+                            60a06000f3\
+                            5b600060006001600060006020355af160a052\
+                            600035601c6101006000f560c0526020353b60e052\
+                            6020353f610100526101206000f3\
+                            601180600b6000396000f336600e57602a60005260206000f35b33ff";
+
+fn factory_call(
+    chain: &mut MockChain,
+    from_eth_addr: &[u8; 20],
+    salt: [u8; 32],
+    destruct: bool,
+) -> anyhow::Result<(Vec<u8>, Vec<U256>)> {
+    let from_id = chain
+        .get_account_id_by_eth_address(from_eth_addr)?
+        .expect("from account id");
+    let run_result = chain.deploy(from_id, &hex::decode(FACTORY_CODE)?, 200000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let factory = MockContractInfo::create(from_eth_addr, 0);
+    let factory_id = chain
+        .get_account_id_by_script_hash(&factory.script_hash)?
+        .expect("factory account id");
+    let child_script = compute_create2_script(
+        &factory.eth_addr,
+        &salt,
+        &hex::decode(CHILD_INIT_CODE)?,
+    );
+    let child_eth_addr = contract_script_to_eth_addr(&child_script, false);
+
+    let mut input = salt.to_vec();
+    input.extend_from_slice(&[0u8; 12]);
+    input.extend_from_slice(&child_eth_addr);
+    input.extend_from_slice(&[0u8; 31]);
+    input.push(destruct as u8);
+    let run_result = chain.execute(from_id, factory_id, &input, 2000000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let output = run_result
+        .return_data
+        .chunks(32)
+        .map(U256::from_big_endian)
+        .collect();
+    Ok((child_eth_addr, output))
+}
+
+fn address_to_u256(eth_addr: &[u8]) -> U256 {
+    U256::from_big_endian(eth_addr)
+}
+
+/// A contract cached by CALL and EXTCODESIZE selfdestructs, then CREATE2 to
+/// its address collides since the account only goes away with the
+/// transaction: the cached code is still the one of the destructed child.
+#[test]
+fn test_code_cache_selfdestruct_and_recreate() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let (child_eth_addr, output) = factory_call(&mut chain, &from_eth_addr, [0x11u8; 32], true)?;
+    let child_code_hash =
+        tiny_keccak::keccak256(&hex::decode(CHILD_INIT_CODE)?[11..]);
+    assert_eq!(
+        output,
+        vec![
+            U256::zero(),
+            address_to_u256(&child_eth_addr),
+            U256::from(CHILD_CODE_SIZE),
+            U256::one(),
+            U256::from(42),
+            U256::one(),
+            U256::zero(),
+            U256::from(CHILD_CODE_SIZE),
+            U256::from_big_endian(&child_code_hash),
+        ]
+    );
+    Ok(())
+}
+
+/// EXTCODESIZE of a CREATE2 address before the CREATE2 caches the address as
+/// not registered, the CREATE2 must drop that entry so the child is found by
+/// the EXTCODESIZE and CALL after it.
+#[test]
+fn test_address_cache_not_found_then_create2() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let (child_eth_addr, output) = factory_call(&mut chain, &from_eth_addr, [0x22u8; 32], false)?;
+    assert_eq!(
+        output,
+        vec![
+            U256::zero(),
+            address_to_u256(&child_eth_addr),
+            U256::from(CHILD_CODE_SIZE),
+            U256::one(),
+            U256::from(42),
+        ]
+    );
+    let child_eth_addr: [u8; 20] = child_eth_addr.as_slice().try_into()?;
+    assert!(chain.get_account_id_by_eth_address(&child_eth_addr)?.is_some());
+    Ok(())
+}
@@ -33,9 +33,14 @@ pub(crate) mod sudt_erc20_proxy;
 pub(crate) mod sudt_erc20_proxy_attack_allowance;
 
 mod absent_address;
+mod access_list;
+mod access_set;
 mod address_collision;
 mod beacon_proxy;
+mod code_analysis;
+mod code_cache;
 mod error;
 mod eth_addr_reg;
 mod gas_price;
+mod storage_cache;
 mod utils;
@@ -227,3 +227,186 @@ fn test_parse_log_event() {
         }
     }
 }
+
+/// Emits n LOG2 (64 bytes data, topics (0xaa, i) for i = n..1), then
+/// reverts if calldata[32..64] is non-zero.
+///
+/// Runtime code:
+/// ```text
+/// 00 PUSH1 0; CALLDATALOAD
+/// 03 JUMPDEST; DUP1; ISZERO; PUSH1 0x18; JUMPI
+/// 09 DUP1; PUSH1 0xaa; PUSH1 0x40; PUSH1 0; LOG2
+/// 11 PUSH1 1; SWAP1; SUB; PUSH1 0x03; JUMP
+/// 18 JUMPDEST; PUSH1 0x20; CALLDATALOAD; ISZERO; PUSH1 0x24; JUMPI
+/// 20 PUSH1 0; DUP1; REVERT
+/// 24 JUMPDEST; STOP
+/// ```
+const LOG_LOOP_CODE: &str = "602680600b6000396000f3\
+                             6000355b80156018578060aa60406000a2600190036003565b\
+                             60203515602457600080fd5b00";
+
+/// Cycles of a transaction emitting many LOG2 in one frame, the shape of
+/// ERC20 Transfer events inside a DEX router.
+#[test]
+fn bench_emit_many_logs() -> anyhow::Result<()> {
+    const LOG_COUNT: usize = 200;
+
+    let mut chain = crate::ctx::MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    let from_id = chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let run_result = chain.deploy(from_id, &hex::decode(LOG_LOOP_CODE)?, 100000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let contract_info = crate::helper::MockContractInfo::create(&from_eth_addr, 0);
+    let contract_id = chain
+        .get_account_id_by_script_hash(&contract_info.script_hash)?
+        .expect("contract account id");
+
+    let input = hex::decode(format!("{:064x}", LOG_COUNT))?;
+    let run_result = chain.execute(from_id, contract_id, &input, 1000000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+
+    let mut user_logs = 0;
+    for log_item in run_result.write.logs.iter() {
+        if let Log::PolyjuiceUser { data, topics, .. } = parse_log(log_item) {
+            // emitted for i = n, n - 1, ..., 1
+            assert_eq!(data.len(), 64);
+            assert_eq!(topics.len(), 2);
+            assert_eq!(topics[0].as_slice()[31], 0xaa);
+            assert_eq!(
+                U256::from_big_endian(topics[1].as_slice()),
+                U256::from(LOG_COUNT - user_logs)
+            );
+            user_logs += 1;
+        }
+    }
+    assert_eq!(user_logs, LOG_COUNT);
+
+    let cycles = run_result.cycles.execution + run_result.cycles.r#virtual;
+    println!(
+        "[bench_emit_many_logs] {} logs: {} cycles, {} cycles/log",
+        LOG_COUNT,
+        cycles,
+        cycles / LOG_COUNT as u64
+    );
+    crate::helper::check_cycles("bench_emit_many_logs", run_result.cycles, 20_000_000);
+    Ok(())
+}
+
+/// Logs of a reverted sub-call are dropped, the ones of its successful
+/// siblings are kept in order, after the sUDT transfer of the value they were
+/// called with.
+#[test]
+fn test_reverted_frame_drops_logs() -> anyhow::Result<()> {
+    const MULTICALL3_CODE: &str = include_str!("./evm-contracts/Multicall3.bin");
+    let mut chain = crate::ctx::MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    let from_id = chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let run_result = chain.deploy(from_id, &hex::decode(LOG_LOOP_CODE)?, 100000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let _ = chain.deploy(from_id, &hex::decode(MULTICALL3_CODE)?, 1000000, 1, 0)?;
+    let log_contract = crate::helper::MockContractInfo::create(&from_eth_addr, 0);
+    let multicall_contract = crate::helper::MockContractInfo::create(&from_eth_addr, 1);
+    let multicall_id = chain
+        .get_account_id_by_script_hash(&multicall_contract.script_hash)?
+        .expect("contract account id");
+
+    // aggregate3Value((address,bool,uint256,bytes)[]) with allowFailure = true:
+    //   call 0 emits 2 logs and reverts, call 1 with value 2 emits 3 logs
+    let log_contract_addr = hex::encode(&log_contract.eth_addr);
+    let call3_value = |n: u64, revert: u64, value: u64| {
+        format!(
+            "{:0>64}{:064x}{:064x}{:064x}{:064x}{:064x}{:064x}",
+            log_contract_addr, 1, value, 0x80, 0x40, n, revert
+        )
+    };
+    let input = hex::decode(format!(
+        "174dea71{:064x}{:064x}{:064x}{:064x}{}{}",
+        0x20,
+        2,
+        0x40,
+        0x120,
+        call3_value(2, 1, 0),
+        call3_value(3, 0, 2)
+    ))?;
+    let run_result = chain.execute(from_id, multicall_id, &input, 1000000, 1, 2)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+
+    let mut events = Vec::new();
+    for log_item in run_result.write.logs.iter() {
+        match parse_log(log_item) {
+            Log::SudtTransfer {
+                to_addr, amount, ..
+            } => events.push(format!(
+                "transfer {} to {}",
+                amount,
+                hex::encode(&to_addr.address)
+            )),
+            Log::PolyjuiceUser {
+                address, topics, ..
+            } => {
+                assert_eq!(&address[..], &log_contract.eth_addr[..]);
+                events.push(format!(
+                    "log {}",
+                    U256::from_big_endian(topics[1].as_slice())
+                ));
+            }
+            _ => {}
+        }
+    }
+    assert_eq!(
+        events,
+        vec![
+            format!(
+                "transfer 2 to {}",
+                hex::encode(&multicall_contract.eth_addr)
+            ),
+            format!("transfer 2 to {}", log_contract_addr),
+            "log 3".to_string(),
+            "log 2".to_string(),
+            "log 1".to_string(),
+        ]
+    );
+    Ok(())
+}
+
+/// `LOG0(0, calldata[0..32])`
+const LOG_SIZED_CODE: &str = "600780600b6000396000f3\
+                              6000356000a000";
+
+/// A log that does not fit in the log buffer fails its frame with
+/// ERROR_LOG_BUFFER_FULL, the largest one that fits is kept.
+#[test]
+fn test_log_buffer_full() -> anyhow::Result<()> {
+    // LOG_BUFFER_MAX_SIZE - entry header (12) - user log header (28)
+    const MAX_LOG_DATA_SIZE: u64 = 256 * 1024 - 12 - 28;
+    const ERROR_LOG_BUFFER_FULL: i8 = -97;
+
+    let mut chain = crate::ctx::MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    let from_id = chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let run_result = chain.deploy(from_id, &hex::decode(LOG_SIZED_CODE)?, 100000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let contract_info = crate::helper::MockContractInfo::create(&from_eth_addr, 0);
+    let contract_id = chain
+        .get_account_id_by_script_hash(&contract_info.script_hash)?
+        .expect("contract account id");
+
+    let input = hex::decode(format!("{:064x}", MAX_LOG_DATA_SIZE))?;
+    let run_result = chain.execute(from_id, contract_id, &input, 3000000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let user_logs: Vec<_> = run_result
+        .write
+        .logs
+        .iter()
+        .filter_map(|log_item| match parse_log(log_item) {
+            Log::PolyjuiceUser { data, .. } => Some(data.len() as u64),
+            _ => None,
+        })
+        .collect();
+    assert_eq!(user_logs, vec![MAX_LOG_DATA_SIZE]);
+
+    let input = hex::decode(format!("{:064x}", MAX_LOG_DATA_SIZE + 1))?;
+    let run_result = chain.execute(from_id, contract_id, &input, 3000000, 1, 0)?;
+    assert_eq!(run_result.exit_code, ERROR_LOG_BUFFER_FULL);
+    Ok(())
+}
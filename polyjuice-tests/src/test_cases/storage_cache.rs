@@ -0,0 +1,205 @@
+//! Test the per-transaction storage cache: SSTORE gas of the cached slots and
+//! the rollback of the writes made by a reverted frame
+//!
+//! Polyjuice does not apply SSTORE gas refunds, so the gas used of the
+//! scenarios below is the plain EIP-2929/EIP-2200 cost without refund.
+
+use crate::{
+    ctx::MockChain,
+    helper::{get_gas_used, MockContractInfo, PolyjuiceArgsBuilder},
+};
+use gw_common::H256;
+use gw_types::{bytes::Bytes, packed::RawL2Transaction, prelude::*, U256};
+
+/// Init code of a contract whose constructor sets slot 0 to 1
+fn storage_contract_code(runtime: &str) -> Vec<u8> {
+    let runtime = hex::decode(runtime).unwrap();
+    let mut code = hex::decode(format!(
+        "600160005560{:02x}8060106000396000f3",
+        runtime.len()
+    ))
+    .unwrap();
+    code.extend(runtime);
+    code
+}
+
+fn slot(index: u8) -> H256 {
+    let mut key = [0u8; 32];
+    key[31] = index;
+    key.into()
+}
+
+/// Deploy a storage contract, call it with empty calldata and return the gas
+/// used, the return data and the contract account id
+fn run_storage_scenario(
+    chain: &mut MockChain,
+    runtime: &str,
+) -> anyhow::Result<(u64, Vec<u8>, u32)> {
+    let from_eth_addr = [1u8; 20];
+    let from_id = chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let run_result = chain.deploy(from_id, &storage_contract_code(runtime), 200000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let contract = MockContractInfo::create(&from_eth_addr, 0);
+    let contract_id = chain
+        .get_account_id_by_script_hash(&contract.script_hash)?
+        .expect("contract account id");
+    let run_result = chain.execute(from_id, contract_id, &[], 100000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    Ok((
+        get_gas_used(&run_result.write.logs),
+        run_result.return_data.to_vec(),
+        contract_id,
+    ))
+}
+
+/// `SSTORE(0, 2); SSTORE(0, 1)`: cold modify, then reset to the original
+/// value for 100 gas (EIP-2200 would refund 2800)
+#[test]
+fn test_sstore_reset_to_original() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let (gas_used, _, contract_id) = run_storage_scenario(&mut chain, "60026000556001600055")?;
+    assert_eq!(gas_used, 21000 + 3 + 3 + 2100 + 2900 + 3 + 3 + 100);
+    assert_eq!(chain.get_storage(contract_id, &slot(0))?, slot(1));
+    Ok(())
+}
+
+/// `SSTORE(0, 0)`: cold delete (EIP-3529 would refund 4800)
+#[test]
+fn test_sstore_delete() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let (gas_used, _, contract_id) = run_storage_scenario(&mut chain, "6000600055")?;
+    assert_eq!(gas_used, 21000 + 3 + 3 + 2100 + 2900);
+    assert_eq!(chain.get_storage(contract_id, &slot(0))?, H256::zero());
+    Ok(())
+}
+
+/// `SSTORE(0, 2); SSTORE(0, 3)`: cold modify, then modify again
+#[test]
+fn test_sstore_modify_again() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let (gas_used, _, contract_id) = run_storage_scenario(&mut chain, "60026000556003600055")?;
+    assert_eq!(gas_used, 21000 + 3 + 3 + 2100 + 2900 + 3 + 3 + 100);
+    assert_eq!(chain.get_storage(contract_id, &slot(0))?, slot(3));
+    Ok(())
+}
+
+/// `SSTORE(1, 5)`: cold add
+#[test]
+fn test_sstore_add() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let (gas_used, _, contract_id) = run_storage_scenario(&mut chain, "6005600155")?;
+    assert_eq!(gas_used, 21000 + 3 + 3 + 2100 + 20000);
+    assert_eq!(chain.get_storage(contract_id, &slot(0))?, slot(1));
+    assert_eq!(chain.get_storage(contract_id, &slot(1))?, slot(5));
+    Ok(())
+}
+
+/// `SSTORE(0, 2); return SLOAD(0)`: the read is served from the cache, warm
+#[test]
+fn test_sstore_then_sload() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let (gas_used, return_data, contract_id) =
+        run_storage_scenario(&mut chain, "600260005560005460005260206000f3")?;
+    assert_eq!(
+        gas_used,
+        21000 + 3 + 3 + 2100 + 2900 + 3 + 100 + 3 + 6 + 3 + 3
+    );
+    assert_eq!(return_data, slot(2).as_slice());
+    assert_eq!(chain.get_storage(contract_id, &slot(0))?, slot(2));
+    Ok(())
+}
+
+/// Calls itself with 1 byte calldata, the sub-call sets slot 0 to 7 and
+/// reverts, then returns (success of the sub-call, SLOAD(0)).
+///
+/// Runtime code:
+/// ```text
+/// 00 CALLDATASIZE; PUSH1 0x1f; JUMPI
+/// 04 PUSH1 0; PUSH1 0; PUSH1 1; PUSH1 0; PUSH1 0; ADDRESS; GAS; CALL
+/// 11 PUSH1 0; MSTORE; PUSH1 0; SLOAD; PUSH1 0x20; MSTORE
+/// 1a PUSH1 0x40; PUSH1 0; RETURN
+/// 1f JUMPDEST; PUSH1 7; PUSH1 0; SSTORE; PUSH1 0; DUP1; REVERT
+/// ```
+const REVERTED_WRITE_CODE: &str = "36601f5760006000600160006000305af16000526000546020\
+                                   5260406000f35b6007600055600080fd";
+
+/// The write of a reverted sub-call is rolled back while its caller goes on
+#[test]
+fn test_reverted_sub_call_storage() -> anyhow::Result<()> {
+    let mut chain = MockChain::setup("..")?;
+    let (_, return_data, contract_id) = run_storage_scenario(&mut chain, REVERTED_WRITE_CODE)?;
+    let mut expected = H256::zero().as_slice().to_vec();
+    expected.extend_from_slice(slot(1).as_slice());
+    assert_eq!(return_data, expected);
+    assert_eq!(chain.get_storage(contract_id, &slot(0))?, slot(1));
+    Ok(())
+}
+
+/// `LOG0(0, calldata[0..32])`
+const LOG_SIZED_CODE: &str = "600780600b6000396000f36000356000a000";
+
+/// Forwards its calldata to the log contract with 1 wei, then stops whether
+/// the sub-call succeeded or not.
+///
+/// Runtime code:
+/// ```text
+/// CALLDATACOPY(0, 0, 32)
+/// CALL(GAS, <log contract>, 1, 0, 32, 0, 0)
+/// STOP
+/// ```
+fn forward_with_value_code(target: &[u8; 20]) -> Vec<u8> {
+    hex::decode(format!(
+        "602980600b6000396000f3\
+         602060006000376000600060206000600173{}5af100",
+        hex::encode(target)
+    ))
+    .unwrap()
+}
+
+/// The sub-call transfers its value, a direct sUDT write, then fails on a log
+/// that does not fit in the log buffer (ERROR_LOG_BUFFER_FULL). The transfer
+/// can not be rolled back, so the whole transaction is rejected even though
+/// the caller carries on.
+#[test]
+fn test_failed_sub_call_after_transfer() -> anyhow::Result<()> {
+    // LOG_BUFFER_MAX_SIZE - entry header (12) - user log header (28)
+    const MAX_LOG_DATA_SIZE: u64 = 256 * 1024 - 12 - 28;
+    const ERROR_LOG_BUFFER_FULL: i8 = -97;
+
+    let mut chain = MockChain::setup("..")?;
+    let from_eth_addr = [1u8; 20];
+    let from_id = chain.create_eoa_account(&from_eth_addr, 10000000u64.into())?;
+    let run_result = chain.deploy(from_id, &hex::decode(LOG_SIZED_CODE)?, 100000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let log_contract = MockContractInfo::create(&from_eth_addr, 0);
+    let code = forward_with_value_code(&log_contract.eth_addr);
+    let run_result = chain.deploy(from_id, &code, 100000, 1, 0)?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    let forwarder = MockContractInfo::create(&from_eth_addr, 1);
+    let forwarder_id = chain
+        .get_account_id_by_script_hash(&forwarder.script_hash)?
+        .expect("contract account id");
+
+    let raw_tx = |log_data_size: u64| {
+        let args = PolyjuiceArgsBuilder::default()
+            .gas_limit(3000000)
+            .gas_price(1)
+            .value(1)
+            .input(&hex::decode(format!("{:064x}", log_data_size)).unwrap())
+            .build();
+        RawL2Transaction::new_builder()
+            .from_id(from_id.pack())
+            .to_id(forwarder_id.pack())
+            .args(Bytes::from(args).pack())
+            .build()
+    };
+
+    // the log fits, the value reaches the log contract
+    let run_result = chain.execute_raw(raw_tx(MAX_LOG_DATA_SIZE))?;
+    assert_eq!(run_result.exit_code, crate::constant::EVMC_SUCCESS);
+    assert_eq!(chain.get_balance(&log_contract.eth_addr)?, U256::one());
+
+    let run_result = chain.call(raw_tx(MAX_LOG_DATA_SIZE + 1))?;
+    assert_eq!(run_result.exit_code, ERROR_LOG_BUFFER_FULL);
+    Ok(())
+}